@@ -1,5 +1,6 @@
 // aggregate/aggregate.cpp
 #include "aggregate/aggregate.h"
+#include "common/perf.h"
 #include <algorithm>
 #include <cmath>
 #include <cassert>
@@ -16,80 +17,245 @@ namespace
 }
 
 Aggregator::Aggregator(const AggConfig &c)
-    : cfg_(c), ema_q_(c.junctions, 0.f) {}
+    : cfg_(c),
+      lanes_(c.lanes ? c.lanes : std::make_shared<const LaneIndex>(LaneIndex::uniform(c.junctions, c.lanes_per))),
+      ema_q_(c.junctions),
+      win_(c.junctions, c.window, partition()),
+      graph_(c.graph)
+{
+  // First touch from the calling thread's OpenMP team with the same
+  // lane-balanced partitioning as map_features, so each junction's state is
+  // node-local.
+  numa::parallel_fill(ema_q_, 0.f, partition());
+  if (graph_)
+  {
+    assert(graph_->rows() == c.junctions && "junction graph must cover every junction");
+    graph_parts_ = graph_->split(static_cast<int>(parts_.size()) - 1);
+    x_.resize(c.junctions);
+    numa::parallel_fill(x_, Pressure{}, parts_);
+    for (auto *v : {&xr_, &yr_})
+    {
+      v->resize(c.junctions);
+      numa::parallel_fill(*v, Pressure{}, graph_parts_);
+    }
+  }
+}
+
+const std::vector<uint32_t> &Aggregator::partition()
+{
+#ifdef _OPENMP
+  const int team = omp_get_max_threads();
+#else
+  const int team = 1;
+#endif
+  if (parts_.size() != static_cast<size_t>(team) + 1)
+    parts_ = lanes_->split(team);
+  return parts_;
+}
 
 void Aggregator::map_features(const std::vector<SensorSample> &samples, std::vector<Features> &out)
+{
+  map_features(samples.data(), samples.size(), out);
+}
+
+void Aggregator::map_features(const SensorSample *samples, size_t n, std::vector<Features> &out)
 {
   // Guard against mismatched sample sizes
-  const size_t expected = static_cast<size_t>(cfg_.junctions) * static_cast<size_t>(cfg_.lanes_per);
-  assert(samples.size() == expected && "samples.size() must be junctions * lanes_per");
-  if (samples.size() != expected)
+  const size_t expected = lanes_->samples();
+  assert(n == expected && "samples must follow the lane index (sum of lanes per junction)");
+  if (n != expected)
   {
     out.clear();
     return;
   }
 
-  out.assign(cfg_.junctions, Features{});
+  const std::vector<uint32_t> &parts = partition();
+  win_.begin_tick();
+  if (out.capacity() < cfg_.junctions)
+  {
+    // Fresh tick buffer (its first tick; smp recycles them): place its pages
+    // with the loop's partitioning.
+    out.assign(cfg_.junctions, Features{});
+    numa::retouch(out, parts);
+  }
+  else
+  {
+    out.resize(cfg_.junctions); // every slot is overwritten below
+  }
+
+  // One contiguous run of junctions per thread, cut so each run holds about
+  // the same number of lanes (a 12-lane arterial costs 6x a 2-lane side street).
+  stream_ = false;
+  const int nparts = static_cast<int>(parts.size()) - 1;
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+  for (int t = 0; t < nparts; ++t)
+  {
+    perf::Region r("agg.map");
+    map_run(samples, 0, parts[t], parts[t + 1], out.data(), 0);
+  }
+  win_.end_tick();
+  if (graph_)
+    propagate(out);
+}
+
+void Aggregator::begin_tick()
+{
+  stream_ = true;
+  win_.begin_tick();
+}
 
-// Parallel over junctions
-#pragma omp parallel for schedule(static)
-  for (int j = 0; j < static_cast<int>(cfg_.junctions); ++j)
+void Aggregator::map_block(const SensorSample *samples, uint32_t j0, uint32_t j1, Features *out)
+{
+  // A block is small next to a tick: cut it by lanes across the team rather
+  // than by junction ownership (partition()), which would leave it to one thread.
+  const std::vector<uint32_t> block = lanes_->split(static_cast<int>(partition().size()) - 1, j0, j1);
+  const size_t s0 = lanes_->begin(j0);
+  const int nparts = static_cast<int>(block.size()) - 1;
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+  for (int t = 0; t < nparts; ++t)
   {
-    const size_t base = static_cast<size_t>(j) * cfg_.lanes_per;
+    perf::Region r("agg.map");
+    map_run(samples, s0, block[t], block[t + 1], out, j0);
+  }
+}
 
-    double sum_q = 0.0, sum_a = 0.0, sum_v = 0.0;
-    int cnt = 0;
+void Aggregator::end_tick()
+{
+  win_.end_tick();
+  if (!graph_)
+    return;
+  // This tick's means, in row order, are what the next tick's blocks pull.
+  const JunctionGraph &g = *graph_;
+  if (graph_parts_.size() != parts_.size())
+    graph_parts_ = g.split(static_cast<int>(parts_.size()) - 1);
+  const std::vector<uint32_t> &rows = graph_parts_;
+  const int nparts = static_cast<int>(rows.size()) - 1;
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+  for (int t = 0; t < nparts; ++t)
+    for (uint32_t r = rows[t]; r < rows[t + 1]; ++r)
+      xr_[r] = x_[g.to_junction(r)];
+}
 
-    for (uint32_t l = 0; l < cfg_.lanes_per; ++l)
+void Aggregator::map_run(const SensorSample *samples, size_t s0, uint32_t j0, uint32_t j1, Features *out, uint32_t o0)
+{
+  const uint32_t *off = lanes_->offsets();
+  for (uint32_t j = j0; j < j1; ++j)
+  {
+    const size_t b = off[j] - s0, e = off[j + 1] - s0;
+    Features &dst = out[j - o0];
+
+    // Lane fields are 16-bit, so integer sums are exact and vectorise; the
+    // means below match the old per-lane double accumulation bit for bit.
+    uint32_t sum_q = 0, sum_a = 0, sum_v = 0;
+#pragma omp simd reduction(+ : sum_q, sum_a, sum_v)
+    for (size_t k = b; k < e; ++k)
     {
-      const auto &s = samples[base + l];
-      sum_q += static_cast<double>(s.q_len);
-      sum_a += static_cast<double>(s.arrivals);
-      sum_v += static_cast<double>(s.avg_speed);
-      ++cnt;
+      sum_q += samples[k].q_len;
+      sum_a += samples[k].arrivals;
+      sum_v += samples[k].avg_speed;
     }
+    const uint32_t cnt = static_cast<uint32_t>(e - b);
 
-    // Defensive (should never be zero if lanes_per>0)
+    // Defensive (a junction with no lanes has nothing to report)
     if (cnt == 0)
     {
-      out[j] = Features{};
+      dst = Features{};
+      win_.step(j, 0.f, 0.f, 0.f, dst.f);
+      if (graph_)
+      {
+        x_[j] = Pressure{};
+        if (stream_)
+          upstream(j, dst.f);
+      }
       continue;
     }
 
-    const float mq = static_cast<float>(sum_q / cnt);
-    const float ma = static_cast<float>((sum_a / cnt) / 10.0); // scale to ~[0,1]
-    const float mv = static_cast<float>((sum_v / cnt) / 10.0); // scale to ~[0,1]
+    const float mq = static_cast<float>(static_cast<double>(sum_q) / cnt);
+    const float ma = static_cast<float>((static_cast<double>(sum_a) / cnt) / 10.0); // scale to ~[0,1]
+    const float mv = static_cast<float>((static_cast<double>(sum_v) / cnt) / 10.0); // scale to ~[0,1]
 
     // EWMA of queue length (per junction)
     ema_q_[j] = kAlpha * mq + (1.f - kAlpha) * ema_q_[j];
 
-    const uint64_t ts_ms = samples[base].ts_ms;
+    const uint64_t ts_ms = samples[b].ts_ms;
     const int sec = static_cast<int>((ts_ms / 1000ULL) % kSecPerDay);
     const double ang = (kTwoPi * static_cast<double>(sec)) / static_cast<double>(kSecPerDay);
 
     Features f{};
     f.ts_ms = ts_ms;
-    f.junction = static_cast<uint16_t>(j);
+    f.junction = j;
     f.f[0] = mq;
     f.f[1] = ma;
     f.f[2] = mv;
     f.f[3] = ema_q_[j];
     f.f[4] = static_cast<float>(std::sin(ang)); // time-of-day sin
     f.f[5] = static_cast<float>(std::cos(ang)); // time-of-day cos
-    for (int k = 6; k < MAX_FEATURES; ++k)
-      f.f[k] = 0.f;
+    win_.step(j, mq, ma, mv, f.f);              // windowed statistics, f[6..15]
+    if (graph_)
+    {
+      x_[j] = {mq, ma};
+      if (stream_)
+        upstream(j, f.f);
+    }
 
-    out[j] = f;
+    dst = f;
   }
 }
 
-void Aggregator::reduce_topN(const std::vector<Features> &feats, int N, std::vector<uint16_t> &out_top, bool sort_ids)
+void Aggregator::upstream(uint32_t j, float *f) const
+{
+  // Streaming blocks cannot wait for the rest of the tick: pull the upstream
+  // means of the previous tick (gathered into row order by end_tick).
+  const Pressure y = graph_->pull(graph_->to_row(j), xr_.data());
+  f[kNbrQueue] = y.queue;
+  f[kNbrArrivals] = y.arrivals;
+}
+
+void Aggregator::propagate(std::vector<Features> &out)
+{
+  // When junction ids carry no locality the SpMV runs in graph row (RCM)
+  // order, where a row's upstream columns are close by. Moving in and out of
+  // that order are two gathers (random 8-byte reads, sequential writes)
+  // rather than scatters into the 80-byte feature records; in the identity
+  // order the first is skipped and the second is sequential.
+  const JunctionGraph &g = *graph_;
+  if (graph_parts_.size() != parts_.size())
+    graph_parts_ = g.split(static_cast<int>(parts_.size()) - 1);
+  const std::vector<uint32_t> &rows = graph_parts_;
+  const std::vector<uint32_t> &juncs = parts_;
+  const int nparts = static_cast<int>(rows.size()) - 1;
+  const Pressure *x = x_.data();
+  if (g.reordered())
+  {
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+    for (int t = 0; t < nparts; ++t)
+      for (uint32_t r = rows[t]; r < rows[t + 1]; ++r)
+        xr_[r] = x_[g.to_junction(r)];
+    x = xr_.data();
+  }
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+  for (int t = 0; t < nparts; ++t)
+  {
+    perf::Region r("agg.spmv");
+    g.spmv(rows[t], rows[t + 1], x, yr_.data());
+  }
+#pragma omp parallel for schedule(static, 1) num_threads(nparts)
+  for (int t = 0; t < nparts; ++t)
+    for (uint32_t j = juncs[t]; j < juncs[t + 1]; ++j)
+    {
+      const Pressure &y = yr_[g.to_row(j)];
+      out[j].f[kNbrQueue] = y.queue;
+      out[j].f[kNbrArrivals] = y.arrivals;
+    }
+}
+
+void Aggregator::reduce_topN(const std::vector<Features> &feats, int N, std::vector<uint32_t> &out_top, bool sort_ids)
 {
   out_top.clear();
   if (N <= 0 || feats.empty())
     return;
 
-  std::vector<std::pair<float, uint16_t>> score;
+  std::vector<std::pair<float, uint32_t>> score;
   score.reserve(feats.size());
   for (const auto &f : feats)
   {
@@ -2,26 +2,67 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
 #include "common/schema.h"
+#include "common/numa.h"
+#include "common/lanes.h"
+#include "aggregate/window.h"
+#include "aggregate/graph.h"
 
 struct AggConfig
 {
   uint32_t junctions{0};
   uint32_t lanes_per{0};
+  std::shared_ptr<const LaneIndex> lanes; // per-junction lanes (null = lanes_per each)
+  WindowConfig window{};                  // sliding windows behind f[6..15]
+  std::shared_ptr<const JunctionGraph> graph{}; // upstream graph behind f[16..17] (null = zeros)
 };
 
 class Aggregator
 {
 public:
   explicit Aggregator(const AggConfig &c);
-  // map: compute rolling features per junction
+  // map: compute rolling features per junction (f[0..5] from this tick,
+  // f[6..15] windowed statistics, see aggregate/window.h; f[16..17] upstream
+  // pressure over the junction graph, see aggregate/graph.h)
   void map_features(const std::vector<SensorSample> &samples, std::vector<Features> &out);
+  // Same, reading samples in place (e.g. from a shared-memory slot).
+  void map_features(const SensorSample *samples, size_t n, std::vector<Features> &out);
+
+  // Streaming (chunked) ticks: begin_tick(), then map_block() for every block
+  // of junctions as it lands, then end_tick(). `samples` holds the block's
+  // lanes only and out[j - j0] receives junction j. Identical to
+  // map_features except that f[16..17] come from the previous tick's means.
+  void begin_tick();
+  void map_block(const SensorSample *samples, uint32_t j0, uint32_t j1, Features *out);
+  void end_tick();
+
   // reduce: produce top-N hotspots (junction id list)
   // If you want IDs sorted ascending (deterministic), set sort_ids=true.
   // If you want results ordered by score desc, set sort_ids=false.
-  void reduce_topN(const std::vector<Features> &feats, int N, std::vector<uint16_t> &out_top, bool sort_ids = true);
+  void reduce_topN(const std::vector<Features> &feats, int N, std::vector<uint32_t> &out_top, bool sort_ids = true);
 
 private:
+  // Lane-balanced junction runs, one per thread of the current OpenMP team.
+  const std::vector<uint32_t> &partition();
+  // Junctions [j0, j1): samples[k - s0] is lane sample k, out[j - o0] junction j.
+  void map_run(const SensorSample *samples, size_t s0, uint32_t j0, uint32_t j1, Features *out, uint32_t o0);
+  // f[16..17] for every junction from this tick's x_ (after the map loop).
+  void propagate(std::vector<Features> &out);
+  // f[16..17] of one junction from the previous tick (streaming).
+  void upstream(uint32_t j, float *f) const;
+
   AggConfig cfg_;
-  std::vector<float> ema_q_; // EWMA per junction
+  std::shared_ptr<const LaneIndex> lanes_;
+  std::vector<uint32_t> parts_;           // LaneIndex::split for parts_.size()-1 threads
+  numa::first_touch_vector<float> ema_q_; // EWMA per junction (placed by the map team)
+  WindowStats win_;                       // per-junction sliding windows
+  bool stream_ = false;                   // inside begin_tick()/end_tick()
+
+  // Neighbor propagation: this tick's queue/arrival means by junction (x_),
+  // then gathered into graph row order (xr_), and the SpMV result (yr_).
+  std::shared_ptr<const JunctionGraph> graph_;
+  std::vector<uint32_t> graph_parts_; // JunctionGraph::split, same team size as parts_
+  numa::first_touch_vector<Pressure> x_, xr_, yr_;
 };
\ No newline at end of file
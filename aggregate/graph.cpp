@@ -0,0 +1,230 @@
+// aggregate/graph.cpp
+#include "aggregate/graph.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+std::shared_ptr<const JunctionGraph> JunctionGraph::load(const char *path, uint32_t junctions)
+{
+  std::string text;
+  if (FILE *f = std::fopen(path, "rb"))
+  {
+    char buf[1 << 16];
+    size_t got;
+    while ((got = std::fread(buf, 1, sizeof(buf), f)) > 0)
+      text.append(buf, got);
+    std::fclose(f);
+  }
+  else
+  {
+    std::fprintf(stderr, "[GRAPH] cannot open %s, neighbor features disabled\n", path);
+    return nullptr;
+  }
+
+  // Hand-rolled parse: a million-junction road graph is a few million lines.
+  std::vector<uint32_t> src, dst;
+  std::vector<float> w;
+  size_t skipped = 0;
+  const char *p = text.c_str();
+  while (*p)
+  {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+      ++p;
+    if (*p == '#')
+    {
+      while (*p && *p != '\n')
+        ++p;
+      continue;
+    }
+    if (!*p)
+      break;
+    char *end;
+    const unsigned long s = std::strtoul(p, &end, 10);
+    const char *q = end;
+    while (*q == ' ' || *q == '\t')
+      ++q;
+    // The destination must be on the same line: strtoul skips newlines too,
+    // so a lone source id would take the next line's source as its dst.
+    const bool two = end != p && *q >= '0' && *q <= '9';
+    const unsigned long d = two ? std::strtoul(q, &end, 10) : 0;
+    if (!two)
+    {
+      // Malformed line: skip it.
+      while (*p && *p != '\n')
+        ++p;
+      ++skipped;
+      continue;
+    }
+    p = end;
+    while (*p == ' ' || *p == '\t')
+      ++p;
+    float wt = 1.f;
+    if (*p && *p != '\n' && *p != '\r' && *p != '#')
+    {
+      wt = std::strtof(p, &end);
+      p = end;
+    }
+    while (*p && *p != '\n')
+      ++p;
+    if (s >= junctions || d >= junctions || s == d)
+    {
+      ++skipped;
+      continue;
+    }
+    src.push_back(static_cast<uint32_t>(s));
+    dst.push_back(static_cast<uint32_t>(d));
+    w.push_back(wt);
+  }
+  if (skipped)
+    std::fprintf(stderr, "[GRAPH] %s: skipped %zu edges (self-loop, malformed or id >= %u)\n", path, skipped, junctions);
+
+  auto g = std::make_shared<JunctionGraph>();
+  g->row_.assign(static_cast<size_t>(junctions) + 1, 0);
+  g->renumber(src, dst, w);
+  return g;
+}
+
+std::shared_ptr<const JunctionGraph> JunctionGraph::from_env(uint32_t junctions)
+{
+  const char *path = std::getenv("GRAPH_FILE");
+  if (!path)
+    return nullptr;
+  auto g = load(path, junctions);
+  if (g)
+    std::fprintf(stderr, "[GRAPH] junctions=%u edges=%zu bandwidth=%u (input %u%s)\n", g->rows(), g->edges(),
+                 g->bandwidth(), g->bandwidth_input(), g->reordered() ? ", RCM" : ", kept");
+  return g;
+}
+
+void JunctionGraph::renumber(const std::vector<uint32_t> &src, const std::vector<uint32_t> &dst, const std::vector<float> &w)
+{
+  const uint32_t n = rows();
+  const size_t m = src.size();
+
+  // Symmetrised adjacency (CSR) for the ordering; direction only matters for
+  // the SpMV itself.
+  std::vector<uint32_t> adj_off(static_cast<size_t>(n) + 1, 0), adj(2 * m);
+  for (size_t e = 0; e < m; ++e)
+  {
+    ++adj_off[src[e] + 1];
+    ++adj_off[dst[e] + 1];
+  }
+  for (uint32_t v = 0; v < n; ++v)
+    adj_off[v + 1] += adj_off[v];
+  {
+    std::vector<uint32_t> fill(adj_off.begin(), adj_off.end() - 1);
+    for (size_t e = 0; e < m; ++e)
+    {
+      adj[fill[src[e]]++] = dst[e];
+      adj[fill[dst[e]]++] = src[e];
+    }
+  }
+  auto degree = [&](uint32_t v) { return adj_off[v + 1] - adj_off[v]; };
+  auto by_degree = [&](uint32_t a, uint32_t b) { return degree(a) != degree(b) ? degree(a) < degree(b) : a < b; };
+  for (uint32_t v = 0; v < n; ++v)
+    std::sort(adj.begin() + adj_off[v], adj.begin() + adj_off[v + 1], by_degree);
+
+  // Cuthill-McKee: breadth-first from a low-degree vertex of each component,
+  // visiting neighbours by increasing degree; reversed at the end.
+  std::vector<uint32_t> start(n);
+  for (uint32_t v = 0; v < n; ++v)
+    start[v] = v;
+  std::sort(start.begin(), start.end(), by_degree);
+  std::vector<uint8_t> seen(n, 0);
+  perm_.clear();
+  perm_.reserve(n);
+  for (uint32_t s : start)
+  {
+    if (seen[s])
+      continue;
+    seen[s] = 1;
+    size_t head = perm_.size();
+    perm_.push_back(s);
+    while (head < perm_.size())
+    {
+      const uint32_t v = perm_[head++];
+      for (uint32_t k = adj_off[v]; k < adj_off[v + 1]; ++k)
+        if (!seen[adj[k]])
+        {
+          seen[adj[k]] = 1;
+          perm_.push_back(adj[k]);
+        }
+    }
+  }
+  std::reverse(perm_.begin(), perm_.end());
+  inv_.resize(n);
+  for (uint32_t r = 0; r < n; ++r)
+    inv_[perm_[r]] = r;
+
+  // Moving in and out of row order costs two gathers per tick, which only
+  // pay off when the input numbering is scattered; an already banded input
+  // (ids assigned along the streets) keeps its own order.
+  auto span = [](uint32_t a, uint32_t b) { return a > b ? a - b : b - a; };
+  uint32_t bw = 0;
+  for (size_t e = 0; e < m; ++e)
+  {
+    bw_in_ = std::max(bw_in_, span(src[e], dst[e]));
+    bw = std::max(bw, span(inv_[src[e]], inv_[dst[e]]));
+  }
+  reordered_ = 2ull * bw <= bw_in_;
+  if (!reordered_)
+    for (uint32_t v = 0; v < n; ++v)
+      perm_[v] = inv_[v] = v;
+
+  // CSR by destination row, upstream columns ascending within a row.
+  std::fill(row_.begin(), row_.end(), 0);
+  for (size_t e = 0; e < m; ++e)
+    ++row_[inv_[dst[e]] + 1];
+  for (uint32_t r = 0; r < n; ++r)
+    row_[r + 1] += row_[r];
+  std::vector<std::pair<uint32_t, float>> edge(m);
+  {
+    std::vector<uint32_t> fill(row_.begin(), row_.end() - 1);
+    for (size_t e = 0; e < m; ++e)
+      edge[fill[inv_[dst[e]]]++] = {inv_[src[e]], w[e]};
+  }
+  col_.resize(m);
+  w_.resize(m);
+  for (uint32_t r = 0; r < n; ++r)
+  {
+    std::sort(edge.begin() + row_[r], edge.begin() + row_[r + 1]);
+    for (uint32_t k = row_[r]; k < row_[r + 1]; ++k)
+    {
+      col_[k] = edge[k].first;
+      w_[k] = edge[k].second;
+      bw_rcm_ = std::max(bw_rcm_, span(edge[k].first, r));
+    }
+  }
+}
+
+std::vector<uint32_t> JunctionGraph::split(int parts) const
+{
+  // Cost of rows [0, r) ~ edges + rows (every row writes its output).
+  parts = std::max(1, parts);
+  const uint32_t n = rows();
+  const uint64_t total = static_cast<uint64_t>(edges()) + n;
+  std::vector<uint32_t> b(static_cast<size_t>(parts) + 1);
+  for (int t = 0; t <= parts; ++t)
+  {
+    const uint64_t target = total * t / parts;
+    uint32_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+      const uint32_t mid = lo + (hi - lo) / 2;
+      if (static_cast<uint64_t>(row_[mid]) + mid < target)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    b[t] = lo;
+  }
+  b[parts] = n;
+  return b;
+}
+
+void JunctionGraph::spmv(uint32_t r0, uint32_t r1, const Pressure *x, Pressure *y) const
+{
+  for (uint32_t r = r0; r < r1; ++r)
+    y[r] = pull(r, x);
+}
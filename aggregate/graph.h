@@ -0,0 +1,79 @@
+// aggregate/graph.h
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "common/schema.h"
+
+// Feature slots filled from the junction graph (see Aggregator::map_features).
+enum NeighborFeature : int
+{
+  kNbrQueue = 16,   // sum over upstream junctions of w * queue mean
+  kNbrArrivals = 17 // sum over upstream junctions of w * arrivals mean
+};
+static_assert(kNbrArrivals < MAX_FEATURES, "neighbor features overflow Features::f");
+
+// Per-junction signals propagated together (one cache line fetch for both).
+struct Pressure
+{
+  float queue, arrivals;
+};
+
+// Directed road graph between junctions, stored as CSR by destination: row r
+// lists the upstream junctions feeding it, so one sparse matrix-vector step
+// per tick yields the weighted upstream pressure on every junction.
+//
+// Rows and columns use a reverse Cuthill-McKee numbering of the (symmetrised)
+// graph, so a row's neighbours sit close to it and the SpMV reads stay in
+// cache; to_row()/to_junction() translate to and from junction ids. When the
+// input ids are already banded (RCM would not halve the bandwidth) rows are
+// the junction ids themselves and reordered() is false.
+class JunctionGraph
+{
+public:
+  // Edge list, one "src dst [weight]" per line (weight defaults to 1, '#'
+  // starts a comment); ids outside [0, junctions) are skipped.
+  static std::shared_ptr<const JunctionGraph> load(const char *path, uint32_t junctions);
+  // GRAPH_FILE=<path>, or null when unset.
+  static std::shared_ptr<const JunctionGraph> from_env(uint32_t junctions);
+
+  [[nodiscard]] uint32_t rows() const { return static_cast<uint32_t>(row_.size() - 1); }
+  [[nodiscard]] size_t edges() const { return col_.size(); }
+  [[nodiscard]] uint32_t to_row(uint32_t junction) const { return inv_[junction]; }
+  [[nodiscard]] uint32_t to_junction(uint32_t row) const { return perm_[row]; }
+  // Largest |row - col| over all edges, before and after renumbering.
+  [[nodiscard]] uint32_t bandwidth() const { return bw_rcm_; }
+  [[nodiscard]] uint32_t bandwidth_input() const { return bw_in_; }
+  [[nodiscard]] bool reordered() const { return reordered_; }
+
+  // Row boundaries cutting the matrix into `parts` runs of about equal
+  // edge counts (one per thread).
+  [[nodiscard]] std::vector<uint32_t> split(int parts) const;
+
+  // y[r] = sum w * x[c] over the upstream edges of rows [r0, r1); x and y
+  // are in row (RCM) order.
+  void spmv(uint32_t r0, uint32_t r1, const Pressure *x, Pressure *y) const;
+  // One row of the same product.
+  [[nodiscard]] Pressure pull(uint32_t r, const Pressure *x) const
+  {
+    float sq = 0.f, sa = 0.f;
+    for (uint32_t k = row_[r]; k < row_[r + 1]; ++k)
+    {
+      const Pressure &p = x[col_[k]];
+      sq += w_[k] * p.queue;
+      sa += w_[k] * p.arrivals;
+    }
+    return {sq, sa};
+  }
+
+private:
+  void renumber(const std::vector<uint32_t> &src, const std::vector<uint32_t> &dst, const std::vector<float> &w);
+
+  std::vector<uint32_t> row_; // rows + 1 offsets into col_/w_
+  std::vector<uint32_t> col_; // upstream row per edge
+  std::vector<float> w_;      // edge weight
+  std::vector<uint32_t> perm_, inv_; // row -> junction, junction -> row
+  uint32_t bw_in_ = 0, bw_rcm_ = 0;
+  bool reordered_ = false;
+};
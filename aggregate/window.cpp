@@ -0,0 +1,137 @@
+// aggregate/window.cpp
+#include "aggregate/window.h"
+#include <algorithm>
+#include <cmath>
+
+WindowStats::WindowStats(uint32_t junctions, const WindowConfig &cfg, const std::vector<uint32_t> &parts)
+    : ws_(std::clamp<uint32_t>(cfg.short_ticks, 2, 255)),
+      wl_(std::max(ws_, cfg.long_ticks)),
+      qrow_(static_cast<size_t>(junctions) * ws_), hist_q_(wl_), hist_a_(ws_), hist_v_(ws_),
+      sq_(junctions), sql_(junctions), iq_(junctions), m2q_(junctions),
+      sa_(junctions), ia_(junctions), sv_(junctions), m2v_(junctions),
+      dq_min_(static_cast<size_t>(junctions) * ws_), dq_max_(static_cast<size_t>(junctions) * ws_),
+      dq_pos_(junctions)
+{
+  // Every column is zeroed (the history must read as 0 before it wraps) by
+  // the thread that will step that junction range.
+  for (auto *ring : {&hist_q_, &hist_a_, &hist_v_})
+    for (auto &c : *ring)
+    {
+      c.resize(junctions);
+      numa::parallel_fill(c, 0.f, parts);
+    }
+  for (auto *c : {&sq_, &sql_, &iq_, &m2q_, &sa_, &ia_, &sv_, &m2v_})
+    numa::parallel_fill(*c, 0.0, parts);
+  numa::parallel_fill(dq_pos_, DqPos{}, parts);
+  std::vector<uint32_t> scaled(parts);
+  for (auto &b : scaled)
+    b *= ws_;
+  numa::parallel_fill(qrow_, 0.f, scaled);
+  numa::parallel_fill(dq_min_, uint8_t{0}, scaled);
+  numa::parallel_fill(dq_max_, uint8_t{0}, scaled);
+}
+
+void WindowStats::begin_tick()
+{
+  const uint64_t t = seen_;
+  TickConsts &k = k_;
+  k.full = t >= ws_;
+  k.slot = static_cast<uint32_t>(t % ws_);
+  k.cs = k.full ? ws_ : static_cast<double>(t + 1);
+  const double cl = t >= wl_ ? wl_ : static_cast<double>(t + 1);
+  const double prev = k.full ? k.cs : k.cs - 1; // short-window samples before this tick
+  k.inv_cs = 1.0 / k.cs;
+  k.inv_cl = 1.0 / cl;
+  k.inv_prev = prev > 0 ? 1.0 / prev : 0.0;
+  k.sx = k.cs * (k.cs - 1) / 2;
+  const double sxx = (k.cs - 1) * k.cs * (2 * k.cs - 1) / 6;
+  const double den = k.cs * sxx - k.sx * k.sx;
+  k.inv_den = den > 0 ? 1.0 / den : 0.0;
+  // Ring slots being overwritten hold the samples leaving each window (all
+  // zero until the ring wraps).
+  k.hql = hist_q_[t % wl_].data();
+  k.ha = hist_a_[k.slot].data();
+  k.hv = hist_v_[k.slot].data();
+}
+
+namespace
+{
+  // Monotonic deque step over a ring of `ws` slot indices into `row`: expire
+  // the tick whose slot is being reused, drop dominated entries at the back,
+  // push `slot`. Returns the window extremum. h + n < 2 * ws, so wrapping is
+  // a compare, not a division.
+  template <bool Min>
+  inline float slide(uint8_t *d, const float *row, uint8_t &h, uint8_t &n, uint32_t ws, uint32_t slot)
+  {
+    auto at = [ws, d](uint32_t i) -> uint8_t & { return d[i >= ws ? i - ws : i]; };
+    if (n && d[h] == slot)
+    {
+      h = static_cast<uint8_t>(h + 1u == ws ? 0 : h + 1);
+      --n;
+    }
+    const float q = row[slot];
+    while (n)
+    {
+      const float back = row[at(h + n - 1u)];
+      if (Min ? back < q : back > q)
+        break;
+      --n;
+    }
+    at(h + n) = static_cast<uint8_t>(slot);
+    ++n;
+    return row[d[h]];
+  }
+}
+
+void WindowStats::step(uint32_t j, float qf, float af, float vf, float *f)
+{
+  const TickConsts &k = k_;
+  const size_t base = static_cast<size_t>(j) * ws_;
+  float *row = &qrow_[base];
+
+  const double q = qf, a = af, v = vf;
+  const double qo = k.full ? row[k.slot] : 0.0;
+  const double ao = k.full ? k.ha[j] : 0.0, vo = k.full ? k.hv[j] : 0.0;
+  const double ql = k.hql[j];
+  row[k.slot] = qf;
+  k.hql[j] = qf;
+  k.ha[j] = af;
+  k.hv[j] = vf;
+
+  // sum(x*y): once full every surviving sample moves down one index.
+  const double last = k.cs - 1;
+  iq_[j] += (k.full ? qo - sq_[j] : 0.0) + last * q;
+  ia_[j] += (k.full ? ao - sa_[j] : 0.0) + last * a;
+
+  // Sliding Welford: replace the leaving sample (full) or append (filling).
+  const double mq0 = sq_[j] * (k.full ? k.inv_cs : k.inv_prev);
+  const double mv0 = sv_[j] * (k.full ? k.inv_cs : k.inv_prev);
+  sq_[j] += q - qo;
+  sa_[j] += a - ao;
+  sv_[j] += v - vo;
+  sql_[j] += q - ql;
+  const double mq1 = sq_[j] * k.inv_cs, mv1 = sv_[j] * k.inv_cs;
+  if (k.full)
+  {
+    m2q_[j] += (q - qo) * (q - mq1 + qo - mq0);
+    m2v_[j] += (v - vo) * (v - mv1 + vo - mv0);
+  }
+  else
+  {
+    m2q_[j] += (q - mq0) * (q - mq1);
+    m2v_[j] += (v - mv0) * (v - mv1);
+  }
+
+  f[kWinQMean] = static_cast<float>(mq1);
+  f[kWinQMeanLong] = static_cast<float>(sql_[j] * k.inv_cl);
+  f[kWinQStd] = static_cast<float>(std::sqrt(std::max(0.0, m2q_[j] * k.inv_cs)));
+  f[kWinQSlope] = static_cast<float>((k.cs * iq_[j] - k.sx * sq_[j]) * k.inv_den);
+  f[kWinAMean] = static_cast<float>(sa_[j] * k.inv_cs);
+  f[kWinASlope] = static_cast<float>((k.cs * ia_[j] - k.sx * sa_[j]) * k.inv_den);
+  f[kWinVMean] = static_cast<float>(mv1);
+  f[kWinVStd] = static_cast<float>(std::sqrt(std::max(0.0, m2v_[j] * k.inv_cs)));
+
+  DqPos &p = dq_pos_[j];
+  f[kWinQMin] = slide<true>(&dq_min_[base], row, p.head_min, p.len_min, ws_, k.slot);
+  f[kWinQMax] = slide<false>(&dq_max_[base], row, p.head_max, p.len_max, ws_, k.slot);
+}
@@ -0,0 +1,88 @@
+// aggregate/window.h
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "common/schema.h"
+#include "common/numa.h"
+
+struct WindowConfig
+{
+  uint32_t short_ticks = 8; // trend / spread window (2..255)
+  uint32_t long_ticks = 32; // baseline window (>= short_ticks)
+};
+
+// Feature slots filled by WindowStats (f[0..5] come from map_features).
+enum WindowFeature : int
+{
+  kWinQMean = 6,    // queue mean, short window
+  kWinQMeanLong,    // queue mean, long window
+  kWinQMin,         // queue min, short window
+  kWinQMax,         // queue max, short window
+  kWinQStd,         // queue std-dev, short window
+  kWinQSlope,       // queue least-squares slope per tick, short window
+  kWinAMean,        // arrivals mean, short window
+  kWinASlope,       // arrivals slope per tick, short window
+  kWinVMean,        // speed mean, short window
+  kWinVStd,         // speed std-dev, short window
+};
+static_assert(kWinVStd < MAX_FEATURES, "window features overflow Features::f");
+
+// Sliding-window statistics over the last N ticks of each junction, updated
+// in O(1) per tick per junction: running sums for means, the sliding form of
+// Welford's recurrence for variance, a running index-weighted sum for slope,
+// and monotonic deques for min/max.
+//
+// History and running state are stored column-wise (one array per quantity,
+// indexed by junction); the map loop steps each junction right after
+// computing its tick means, so the window update streams through the same
+// junction range while that junction's lines are hot, with no second pass.
+class WindowStats
+{
+public:
+  // `parts` is the map loop's junction partition; it places every column.
+  WindowStats(uint32_t junctions, const WindowConfig &cfg, const std::vector<uint32_t> &parts);
+
+  // Fix the per-tick constants shared by every step() of this tick.
+  void begin_tick();
+  // Fold junction j's tick signals (queue, arrivals, speed) into its windows
+  // and write the window slots of f. Distinct junctions may step concurrently.
+  void step(uint32_t j, float q, float a, float v, float *f);
+  // Close the tick once every junction has been stepped.
+  void end_tick() { ++seen_; }
+
+private:
+  template <typename T>
+  using column = numa::first_touch_vector<T>;
+
+  uint32_t ws_, wl_;
+  uint64_t seen_ = 0; // ticks folded so far
+
+  // Per-tick constants (begin_tick). x = 0..cs-1 indexes the short window
+  // oldest-first; the new sample sits at x = cs-1.
+  struct TickConsts
+  {
+    bool full = false; // short window already holds ws_ samples
+    uint32_t slot = 0; // short-window ring slot of this tick
+    double cs = 1, inv_cs = 1, inv_cl = 1, inv_prev = 0, sx = 0, inv_den = 0;
+    float *hql = nullptr, *ha = nullptr, *hv = nullptr; // ring slots being replaced
+  } k_;
+
+  column<float> qrow_;                         // [J][ws_] queue, short window (junction-major)
+  std::vector<column<float>> hist_q_;          // [wl_][J] queue, long window
+  std::vector<column<float>> hist_a_, hist_v_; // [ws_][J] arrivals / speed
+
+  column<double> sq_, sql_, iq_, m2q_; // queue: sum short/long, sum x*q, Welford M2
+  column<double> sa_, ia_;             // arrivals: sum, sum x*a
+  column<double> sv_, m2v_;            // speed: sum, Welford M2
+
+  // Monotonic min/max deques per junction: rings of ws_ slot indices into
+  // the junction's qrow_ entry (tick t lives in slot t % ws_), so a
+  // junction's short history and both deques fit in a cache line or two.
+  struct DqPos
+  {
+    uint8_t head_min, len_min, head_max, len_max;
+  };
+  column<uint8_t> dq_min_, dq_max_; // [J][ws_]
+  column<DqPos> dq_pos_;
+};
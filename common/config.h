@@ -0,0 +1,195 @@
+// common/config.h
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "common/lanes.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Scenario shared by seq, smp and dist. Every field is set from, in order of
+// precedence, a command-line option, its environment variable, and the
+// driver's default (the values each binary used to hard-code):
+//
+//   --junctions=N      JUNCTIONS      junction count
+//   --lanes=N|LO-HI    LANES          lanes per junction (see common/lanes.h)
+//   --lanes-file=PATH  LANES_FILE     one lane count per line
+//   --ticks=N          TWIN_TICKS     ticks to run
+//   --tick-ms=N        TICK_MS        control tick period
+//   --budget-pred=MS   BUDGET_PRED    predictor budget per slice (dist)
+//   --budget-ctrl=MS   BUDGET_CTRL    controller budget per tick (dist)
+//   --threads=N        TWIN_THREADS   OpenMP team per stage (0 = OMP_NUM_THREADS / runtime default)
+//   --model=cpu|opencl TWIN_MODEL     predictor back end (opencl falls back to cpu)
+//   --ring=N           TWIN_RING      smp ring capacity in blocks
+//   --win-short=N      WIN_SHORT      short sliding window in ticks (2..255)
+//   --win-long=N       WIN_LONG       long sliding window in ticks (>= win-short)
+//   --results=PATH     TWIN_RESULTS   write the run summary (common/results.h)
+//
+// Mode knobs (DIST_*, TWIN_CHUNK, TWIN_PIN, ...) stay environment-only.
+struct TwinConfig
+{
+  const char *variant = "";
+  uint32_t junctions = 20000;
+  std::string lanes = "3";
+  std::string lanes_file;
+  uint32_t ticks = 20;
+  uint32_t tick_ms = 1000;
+  uint32_t budget_pred_ms = 350;
+  uint32_t budget_ctrl_ms = 150;
+  int threads = 0;
+  bool opencl = false;
+  uint32_t ring = 1024;
+  uint32_t win_short = 8; // WindowConfig (aggregate/window.h)
+  uint32_t win_long = 32;
+  std::string results;
+
+  [[nodiscard]] std::shared_ptr<const LaneIndex> lane_index() const
+  {
+    return LaneIndex::from_spec(junctions, lanes.c_str(), lanes_file.c_str(), 3);
+  }
+
+  // Size the calling thread's OpenMP team (each smp stage thread calls this).
+  void apply_threads() const
+  {
+#ifdef _OPENMP
+    if (threads > 0)
+      omp_set_num_threads(threads);
+#endif
+  }
+
+  [[nodiscard]] int team() const
+  {
+#ifdef _OPENMP
+    return threads > 0 ? threads : omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  void print(FILE *out) const
+  {
+    const std::string l = lanes_file.empty() ? lanes : "file:" + lanes_file;
+    std::fprintf(out, "[CONFIG] %s junctions=%u lanes=%s ticks=%u tick-ms=%u budgets=%u/%ums threads=%d model=%s windows=%u/%u",
+                 variant, junctions, l.c_str(), ticks, tick_ms, budget_pred_ms, budget_ctrl_ms, team(),
+                 opencl ? "opencl" : "cpu", win_short, win_long);
+    if (!results.empty())
+      std::fprintf(out, " results=%s", results.c_str());
+    std::fprintf(out, "\n");
+    std::fflush(out);
+  }
+
+  static void usage(FILE *out, const char *prog)
+  {
+    std::fprintf(out,
+                 "usage: %s [--junctions=N] [--lanes=N|LO-HI] [--lanes-file=PATH] [--ticks=N] [--tick-ms=N]\n"
+                 "          [--budget-pred=MS] [--budget-ctrl=MS] [--threads=N] [--model=cpu|opencl]\n"
+                 "          [--ring=N] [--win-short=N] [--win-long=N] [--results=PATH]\n",
+                 prog);
+  }
+
+  // Environment, then argv. Returns false on --help (err empty) or a bad
+  // option (err says which); the caller prints usage() and exits.
+  bool parse(int argc, char **argv, std::string &err)
+  {
+    struct Opt
+    {
+      const char *flag, *env;
+    };
+    static const Opt kOpts[] = {
+        {"junctions", "JUNCTIONS"}, {"lanes", "LANES"}, {"lanes-file", "LANES_FILE"},
+        {"ticks", "TWIN_TICKS"}, {"tick-ms", "TICK_MS"}, {"budget-pred", "BUDGET_PRED"},
+        {"budget-ctrl", "BUDGET_CTRL"}, {"threads", "TWIN_THREADS"}, {"model", "TWIN_MODEL"},
+        {"ring", "TWIN_RING"}, {"win-short", "WIN_SHORT"}, {"win-long", "WIN_LONG"},
+        {"results", "TWIN_RESULTS"},
+    };
+    for (const Opt &o : kOpts)
+      if (const char *e = std::getenv(o.env); e && *e && !set(o.flag, e, err))
+        return false;
+    for (int i = 1; i < argc; ++i)
+    {
+      const char *a = argv[i];
+      if (!std::strcmp(a, "-h") || !std::strcmp(a, "--help"))
+      {
+        err.clear();
+        return false;
+      }
+      const char *eq = std::strchr(a, '=');
+      if (std::strncmp(a, "--", 2) != 0 || !eq)
+      {
+        err = std::string("expected --option=value, got ") + a;
+        return false;
+      }
+      if (!set(std::string(a + 2, eq).c_str(), eq + 1, err))
+        return false;
+    }
+    if (win_long < win_short)
+    {
+      err = "--win-long=" + std::to_string(win_long) + " is shorter than --win-short=" + std::to_string(win_short);
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static bool to_u32(const char *v, uint32_t lo, uint32_t &out)
+  {
+    char *end = nullptr;
+    const long long x = std::strtoll(v, &end, 10);
+    if (end == v || *end != '\0' || x < lo || x > 100000000LL)
+      return false;
+    out = static_cast<uint32_t>(x);
+    return true;
+  }
+
+  bool set(const char *flag, const char *v, std::string &err)
+  {
+    bool ok = true;
+    uint32_t u = 0;
+    if (!std::strcmp(flag, "junctions"))
+      ok = to_u32(v, 1, junctions);
+    else if (!std::strcmp(flag, "lanes"))
+      lanes = v;
+    else if (!std::strcmp(flag, "lanes-file"))
+      lanes_file = v;
+    else if (!std::strcmp(flag, "ticks"))
+      ok = to_u32(v, 1, ticks);
+    else if (!std::strcmp(flag, "tick-ms"))
+      ok = to_u32(v, 1, tick_ms);
+    else if (!std::strcmp(flag, "budget-pred"))
+      ok = to_u32(v, 1, budget_pred_ms);
+    else if (!std::strcmp(flag, "budget-ctrl"))
+      ok = to_u32(v, 1, budget_ctrl_ms);
+    else if (!std::strcmp(flag, "threads"))
+    {
+      ok = to_u32(v, 0, u);
+      threads = static_cast<int>(u);
+    }
+    else if (!std::strcmp(flag, "model"))
+    {
+      ok = !std::strcmp(v, "cpu") || !std::strcmp(v, "opencl");
+      opencl = !std::strcmp(v, "opencl");
+    }
+    else if (!std::strcmp(flag, "ring"))
+      ok = to_u32(v, 2, ring);
+    else if (!std::strcmp(flag, "win-short"))
+      ok = to_u32(v, 2, win_short) && win_short <= 255;
+    else if (!std::strcmp(flag, "win-long"))
+      ok = to_u32(v, 2, win_long);
+    else if (!std::strcmp(flag, "results"))
+      results = v;
+    else
+    {
+      err = std::string("unknown option --") + flag;
+      return false;
+    }
+    if (!ok)
+      err = std::string("bad value for --") + flag + ": " + v;
+    return ok;
+  }
+};
@@ -7,6 +7,8 @@ inline constexpr int TAG_FEAT = 10; // features
 inline constexpr int TAG_PRED = 11; // predictions
 inline constexpr int TAG_BP = 12;   // back-pressure / control hints
 inline constexpr int TAG_CTRL = 13; // control commands
+inline constexpr int TAG_CAP = 14;  // predictor throughput reports
+inline constexpr int TAG_HEDGE = 15; // controller -> aggregator slice re-issue requests
 
 // Roles for MPI ranks
 enum class Role : int
@@ -0,0 +1,130 @@
+// common/lanes.h
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Lane topology in CSR form: junction j owns samples [begin(j), end(j)) of a
+// tick, laid out in junction order. Built once per topology and shared
+// read-only by the ingestor (sample layout), the aggregator (reduction and
+// thread partitioning) and the dist frames (payload size).
+class LaneIndex
+{
+public:
+  // Every junction has `lanes` lanes (the historical fixed layout).
+  static LaneIndex uniform(uint32_t junctions, uint32_t lanes)
+  {
+    LaneIndex ix;
+    ix.off_.resize(static_cast<size_t>(junctions) + 1);
+    for (uint32_t j = 0; j <= junctions; ++j)
+      ix.off_[j] = j * lanes;
+    return ix;
+  }
+
+  // Per-junction lane counts in [lo, hi], a pure function of the junction id
+  // so that every rank derives the same layout without exchanging it.
+  static LaneIndex varied(uint32_t junctions, uint32_t lo, uint32_t hi)
+  {
+    lo = std::max<uint32_t>(1, lo);
+    hi = std::max(lo, hi);
+    LaneIndex ix;
+    ix.off_.resize(static_cast<size_t>(junctions) + 1);
+    ix.off_[0] = 0;
+    for (uint32_t j = 0; j < junctions; ++j)
+    {
+      uint64_t h = (j + 1) * 0x9E3779B97F4A7C15ull; // splitmix64 finaliser
+      h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+      h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+      h ^= h >> 31;
+      ix.off_[j + 1] = ix.off_[j] + lo + static_cast<uint32_t>(h % (hi - lo + 1));
+    }
+    return ix;
+  }
+
+  // One lane count per line; junctions past the end of the file get `dflt`.
+  static LaneIndex load(const char *path, uint32_t junctions, uint32_t dflt)
+  {
+    LaneIndex ix;
+    ix.off_.resize(static_cast<size_t>(junctions) + 1);
+    ix.off_[0] = 0;
+    FILE *f = std::fopen(path, "r");
+    if (!f)
+      std::fprintf(stderr, "[LANES] cannot open %s, using %u lanes per junction\n", path, dflt);
+    for (uint32_t j = 0; j < junctions; ++j)
+    {
+      unsigned n = 0;
+      if (!f || std::fscanf(f, "%u", &n) != 1 || n == 0)
+        n = dflt;
+      ix.off_[j + 1] = ix.off_[j] + n;
+    }
+    if (f)
+      std::fclose(f);
+    return ix;
+  }
+
+  // LANES_FILE=<path> (one count per line), else LANES=<n> or LANES=<lo>-<hi>;
+  // unset means `dflt` lanes everywhere.
+  static std::shared_ptr<const LaneIndex> from_env(uint32_t junctions, uint32_t dflt)
+  {
+    return from_spec(junctions, std::getenv("LANES"), std::getenv("LANES_FILE"), dflt);
+  }
+
+  // Same, from the values themselves (--lanes / --lanes-file, common/config.h).
+  static std::shared_ptr<const LaneIndex> from_spec(uint32_t junctions, const char *spec, const char *path,
+                                                    uint32_t dflt)
+  {
+    if (path && *path)
+      return std::make_shared<const LaneIndex>(load(path, junctions, dflt));
+    unsigned lo = 0, hi = 0;
+    if (const char *e = spec)
+    {
+      const int got = std::sscanf(e, "%u-%u", &lo, &hi);
+      if (got == 2 && lo > 0 && hi >= lo)
+        return std::make_shared<const LaneIndex>(varied(junctions, lo, hi));
+      if (got >= 1 && lo > 0)
+        dflt = lo;
+    }
+    return std::make_shared<const LaneIndex>(uniform(junctions, dflt));
+  }
+
+  [[nodiscard]] uint32_t junctions() const { return static_cast<uint32_t>(off_.size() - 1); }
+  [[nodiscard]] size_t samples() const { return off_.back(); }
+  [[nodiscard]] uint32_t begin(uint32_t j) const { return off_[j]; }
+  [[nodiscard]] uint32_t end(uint32_t j) const { return off_[j + 1]; }
+  [[nodiscard]] uint32_t lanes(uint32_t j) const { return off_[j + 1] - off_[j]; }
+  [[nodiscard]] const uint32_t *offsets() const { return off_.data(); }
+
+  [[nodiscard]] uint32_t max_lanes() const
+  {
+    uint32_t m = 0;
+    for (uint32_t j = 0; j < junctions(); ++j)
+      m = std::max(m, lanes(j));
+    return m;
+  }
+
+  // Junction boundaries cutting the tick into `parts` contiguous runs of
+  // roughly equal lane counts (run t = [b[t], b[t+1])), so a thread per run
+  // gets the same reduction work however lanes are distributed. [j0, j1)
+  // restricts the cut to one block of junctions.
+  [[nodiscard]] std::vector<uint32_t> split(int parts, uint32_t j0 = 0, uint32_t j1 = UINT32_MAX) const
+  {
+    parts = std::max(1, parts);
+    j1 = std::min(j1, junctions());
+    j0 = std::min(j0, j1);
+    std::vector<uint32_t> b(static_cast<size_t>(parts) + 1);
+    const uint64_t lo = off_[j0], total = off_[j1] - lo;
+    for (int t = 0; t <= parts; ++t)
+    {
+      const uint64_t target = lo + total * t / parts;
+      b[t] = static_cast<uint32_t>(std::lower_bound(off_.begin() + j0, off_.begin() + j1, target) - off_.begin());
+    }
+    b[parts] = j1;
+    return b;
+  }
+
+private:
+  std::vector<uint32_t> off_; // junctions + 1 prefix sums of lane counts
+};
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <mutex>
 #include <chrono>
+#include <cstddef>
+#include <sys/resource.h>
 
 // Global log mutex for line integrity.
 inline std::mutex &log_mutex()
@@ -21,6 +23,19 @@ inline uint64_t log_now_ms()
       .count();
 }
 
+// Peak resident set of this process in bytes (ru_maxrss is KB on Linux,
+// bytes on macOS).
+inline size_t peak_rss_bytes()
+{
+  struct rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return static_cast<size_t>(ru.ru_maxrss);
+#else
+  return static_cast<size_t>(ru.ru_maxrss) * 1024;
+#endif
+}
+
 // Thread-safe single-line logger (printf-style).
 template <typename... Args>
 inline void LOG(const char *fmt, Args... args)
@@ -0,0 +1,284 @@
+// common/numa.h
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Topology-aware placement: NUMA domains, thread pinning and first-touch.
+// Linux reads /sys; elsewhere (macOS) everything degrades to one domain and
+// pinning is a no-op, so callers never need their own #ifdefs.
+namespace numa
+{
+  // Parse a Linux-style cpu list ("0-3,8,10-11") into ids.
+  inline std::vector<int> parse_cpulist(const char *s)
+  {
+    std::vector<int> out;
+    while (s && *s)
+    {
+      char *end = nullptr;
+      long a = std::strtol(s, &end, 10);
+      if (end == s)
+        break;
+      long b = a;
+      if (*end == '-')
+      {
+        s = end + 1;
+        b = std::strtol(s, &end, 10);
+      }
+      for (long c = a; c <= b; ++c)
+        out.push_back(static_cast<int>(c));
+      s = (*end == ',') ? end + 1 : end;
+      while (*s == '\n' || *s == ' ')
+        ++s;
+    }
+    return out;
+  }
+
+  // Compact a cpu id list back into "a-b,c" form for reports.
+  inline std::string format_cpulist(const std::vector<int> &cpus)
+  {
+    std::string s;
+    for (size_t i = 0; i < cpus.size();)
+    {
+      size_t j = i;
+      while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        ++j;
+      if (!s.empty())
+        s += ',';
+      s += std::to_string(cpus[i]);
+      if (j > i)
+        s += '-' + std::to_string(cpus[j]);
+      i = j + 1;
+    }
+    return s;
+  }
+
+  struct Topology
+  {
+    std::vector<std::vector<int>> domains; // cpus per NUMA domain (socket)
+
+    [[nodiscard]] int num_domains() const { return static_cast<int>(domains.size()); }
+    [[nodiscard]] const std::vector<int> &cpus_of(int d) const { return domains[d % domains.size()]; }
+  };
+
+  namespace detail
+  {
+    inline bool read_line(const char *path, std::string &out)
+    {
+      std::FILE *f = std::fopen(path, "r");
+      if (!f)
+        return false;
+      char buf[4096];
+      bool ok = std::fgets(buf, sizeof(buf), f) != nullptr;
+      std::fclose(f);
+      if (ok)
+        out = buf;
+      return ok;
+    }
+  }
+
+  // Detect NUMA domains once. TWIN_CPUS (cpu list) restricts the usable set.
+  inline const Topology &topology()
+  {
+    static const Topology topo = []
+    {
+      Topology t;
+      std::string line;
+#ifdef __linux__
+      for (int n = 0; n < 1024; ++n)
+      {
+        const std::string path = "/sys/devices/system/node/node" + std::to_string(n) + "/cpulist";
+        if (!detail::read_line(path.c_str(), line))
+        {
+          if (n > 0 && t.domains.empty())
+            break;
+          continue;
+        }
+        auto cpus = parse_cpulist(line.c_str());
+        if (!cpus.empty())
+          t.domains.push_back(std::move(cpus));
+      }
+#endif
+      if (t.domains.empty())
+      {
+        std::vector<int> all;
+        const int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int c = 0; c < n; ++c)
+          all.push_back(c);
+        t.domains.push_back(std::move(all));
+      }
+      if (const char *allow = std::getenv("TWIN_CPUS"))
+      {
+        const auto keep = parse_cpulist(allow);
+        std::vector<std::vector<int>> filtered;
+        for (const auto &d : t.domains)
+        {
+          std::vector<int> f;
+          for (int c : d)
+            for (int k : keep)
+              if (c == k)
+                f.push_back(c);
+          if (!f.empty())
+            filtered.push_back(std::move(f));
+        }
+        if (!filtered.empty())
+          t.domains.swap(filtered);
+      }
+      return t;
+    }();
+    return topo;
+  }
+
+  // Pin the calling thread to a cpu set. Returns false where unsupported.
+  inline bool pin_self(const std::vector<int> &cpus)
+  {
+#ifdef __linux__
+    if (cpus.empty())
+      return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus)
+      CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+  }
+
+  inline bool pin_self(int cpu) { return pin_self(std::vector<int>{cpu}); }
+
+  // Cpus the calling thread is currently allowed to run on.
+  inline std::vector<int> current_cpus()
+  {
+    std::vector<int> out;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+      for (int c = 0; c < CPU_SETSIZE; ++c)
+        if (CPU_ISSET(c, &set))
+          out.push_back(c);
+#endif
+    return out;
+  }
+
+  // Size the calling thread's OpenMP team to `cpus` and pin worker i to
+  // cpus[i]. Teams are reused by the runtime, so later parallel regions
+  // started from this thread keep the placement (and the static schedule
+  // keeps hitting the same cores, hence the same first-touched pages).
+  inline void pin_omp_team(const std::vector<int> &cpus)
+  {
+    if (cpus.empty())
+      return;
+#ifdef _OPENMP
+    omp_set_num_threads(static_cast<int>(cpus.size()));
+#pragma omp parallel
+    pin_self(cpus[omp_get_thread_num() % cpus.size()]);
+#else
+    pin_self(cpus[0]);
+#endif
+  }
+
+  // Allocator that default-initialises (i.e. leaves trivially constructible
+  // elements untouched) so a later parallel loop performs the first touch.
+  template <typename T, typename A = std::allocator<T>>
+  struct default_init_allocator : A
+  {
+    using A::A;
+    template <typename U>
+    struct rebind
+    {
+      using other = default_init_allocator<U, typename std::allocator_traits<A>::template rebind_alloc<U>>;
+    };
+    template <typename U>
+    void construct(U *p) noexcept(std::is_nothrow_default_constructible_v<U>)
+    {
+      ::new (static_cast<void *>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args)
+    {
+      std::allocator_traits<A>::construct(static_cast<A &>(*this), p, std::forward<Args>(args)...);
+    }
+  };
+
+  // Per-junction state whose pages are placed by the threads that own them.
+  template <typename T>
+  using first_touch_vector = std::vector<T, default_init_allocator<T>>;
+
+  // Fill with the same static partitioning as the hot loops that use it.
+  template <typename V, typename T>
+  inline void parallel_fill(V &v, const T &value)
+  {
+    const long n = static_cast<long>(v.size());
+    auto *p = v.data();
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; ++i)
+      p[i] = value;
+  }
+
+  // Same, for loops partitioned by work rather than element count: thread t
+  // fills [bounds[t], bounds[t+1]) (e.g. LaneIndex::split).
+  template <typename V, typename T>
+  inline void parallel_fill(V &v, const T &value, const std::vector<uint32_t> &bounds)
+  {
+    const int parts = std::max(1, static_cast<int>(bounds.size()) - 1);
+    auto *p = v.data();
+#pragma omp parallel for schedule(static, 1) num_threads(parts)
+    for (int t = 0; t < parts; ++t)
+      for (uint32_t i = bounds[t]; i < bounds[t + 1]; ++i)
+        p[i] = value;
+  }
+
+  // Drop the whole pages of a buffer; they read back as zero on next touch.
+  template <typename T>
+  inline void drop_pages(std::vector<T> &v)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "retouch needs trivially copyable T");
+#ifdef __linux__
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t lo = (reinterpret_cast<uintptr_t>(v.data()) + page - 1) & ~(page - 1);
+    const uintptr_t hi = reinterpret_cast<uintptr_t>(v.data() + v.size()) & ~(page - 1);
+    if (hi > lo)
+      madvise(reinterpret_cast<void *>(lo), hi - lo, MADV_DONTNEED);
+#else
+    (void)v;
+#endif
+  }
+
+  // Re-place an already value-initialised tick buffer: drop its whole pages
+  // (they read back as zero, i.e. T{}) and re-touch them with a static
+  // schedule so each page lands on the node of the thread that will write it.
+  // Only for trivially copyable T whose all-zero bit pattern equals T{}.
+  template <typename T>
+  inline void retouch(std::vector<T> &v)
+  {
+    drop_pages(v);
+    parallel_fill(v, T{});
+  }
+  template <typename T>
+  inline void retouch(std::vector<T> &v, const std::vector<uint32_t> &bounds)
+  {
+    drop_pages(v);
+    parallel_fill(v, T{}, bounds);
+  }
+} // namespace numa
@@ -0,0 +1,285 @@
+// common/packed.h
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "common/schema.h"
+
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Reduced-precision transport for the Agg->Pred->Ctrl hops (DIST_PACK).
+//
+// A feature slice is a run of junctions j0, j0+stride, ... of one tick, so the
+// id and timestamp of every row are implied by a per-frame header. Only the
+// model inputs f[0..5] travel, one column per feature (structure of arrays,
+// so encode, decode and inference all run over contiguous lanes), each
+// quantized to fp16 or int8 after an affine map onto [-1, 1]:
+//
+//   x = q * scale[k] + offset[k]     (int8: q in [-127, 127]; fp16: q in [-1, 1])
+//
+// A prediction slice is the same kind of header plus one 16-bit fixed-point
+// congestion per row (y = q / 65535).
+//
+//   per junction   fp32 Features 80 B   fp16 12 B   int8 6 B   | Prediction 12 B -> 2 B
+namespace packed
+{
+  enum class Format : uint32_t
+  {
+    None = 0,
+    Fp16 = 1,
+    Int8 = 2,
+  };
+
+  constexpr int kFeatures = 6;   // f[0..5]: the inputs the predictor reads
+  constexpr size_t kBlock = 256; // rows converted per step (column chunks stay in L1)
+
+  struct FeatureHdr
+  {
+    uint32_t ts_ms; // every row of a slice carries the tick's timestamp
+    uint32_t j0;
+    uint32_t stride;
+    uint32_t rows;
+    uint32_t format;    // Format
+    uint32_t col_bytes; // column k starts at sizeof(FeatureHdr) + k * col_bytes
+    uint32_t reserved[2];
+    float scale[kFeatures];
+    float offset[kFeatures];
+  };
+
+  struct PredHdr
+  {
+    uint32_t ts_ms;
+    uint32_t j0;
+    uint32_t stride;
+    uint32_t rows; // followed by rows x uint16_t
+  };
+
+  static_assert(sizeof(FeatureHdr) % 16 == 0 && sizeof(PredHdr) % 16 == 0, "columns must stay aligned");
+
+  inline const char *name(Format f)
+  {
+    return f == Format::Fp16 ? "fp16" : f == Format::Int8 ? "int8" : "fp32";
+  }
+
+  // DIST_PACK=fp16|int8 (anything else: off).
+  inline Format from_env(const char *var)
+  {
+    const char *e = std::getenv(var);
+    if (!e)
+      return Format::None;
+    if (!std::strcmp(e, "fp16"))
+      return Format::Fp16;
+    if (!std::strcmp(e, "int8"))
+      return Format::Int8;
+    return Format::None;
+  }
+
+  inline size_t elem_bytes(Format f) { return f == Format::Int8 ? 1 : 2; }
+  inline size_t round_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+  inline size_t column_bytes(Format f, size_t rows) { return round_up(rows * elem_bytes(f), 32); }
+  inline size_t feature_bytes(Format f, size_t rows) { return sizeof(FeatureHdr) + kFeatures * column_bytes(f, rows); }
+  inline size_t pred_bytes(size_t rows) { return sizeof(PredHdr) + round_up(rows * sizeof(uint16_t), 32); }
+
+  // ---- column conversions (F16C/AVX or NEON, scalar tail) ----
+
+  // IEEE half from float, round to nearest even (the scalar fallback and tails).
+  inline uint16_t half_from_float(float x)
+  {
+    uint32_t b;
+    std::memcpy(&b, &x, 4);
+    const uint32_t sign = (b >> 16) & 0x8000u;
+    const uint32_t abs = b & 0x7fffffffu;
+    if (abs >= 0x47800000u) // overflow, inf or nan
+      return static_cast<uint16_t>(sign | (abs > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    if (abs < 0x38800000u) // subnormal half or zero
+    {
+      const float m = std::fabs(x) * 16777216.f; // 2^24: units of the smallest half subnormal
+      return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(m)));
+    }
+    const uint32_t r = abs + 0xc8000fffu + ((abs >> 13) & 1u); // rebias exponent, round to even
+    return static_cast<uint16_t>(sign | (r >> 13));
+  }
+
+  inline float float_from_half(uint16_t h)
+  {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1fu, m = h & 0x3ffu;
+    uint32_t b;
+    if (e == 0)
+    {
+      const float v = static_cast<float>(m) * (1.f / 16777216.f);
+      std::memcpy(&b, &v, 4);
+      b |= sign;
+    }
+    else if (e == 31)
+      b = sign | 0x7f800000u | (m << 13);
+    else
+      b = sign | ((e + 112u) << 23) | (m << 13);
+    float x;
+    std::memcpy(&x, &b, 4);
+    return x;
+  }
+
+  inline void to_half(const float *src, uint16_t *dst, size_t n)
+  {
+    size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+    for (; i + 8 <= n; i += 8)
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                       _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+      vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+#endif
+    for (; i < n; ++i)
+      dst[i] = half_from_float(src[i]);
+  }
+
+  inline void from_half(const uint16_t *src, float *dst, size_t n)
+  {
+    size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+      vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+#endif
+    for (; i < n; ++i)
+      dst[i] = float_from_half(src[i]);
+  }
+
+  // The integer loops below vectorise as written.
+  inline void to_int8(const float *src, int8_t *dst, size_t n)
+  {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<int8_t>(std::lrintf(std::min(std::max(src[i] * 127.f, -127.f), 127.f)));
+  }
+
+  inline void from_int8(const int8_t *src, float *dst, size_t n)
+  {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<float>(src[i]);
+  }
+
+  // Congestion in [0, 1] as 16-bit fixed point.
+  inline void to_fixed16(const float *src, uint16_t *dst, size_t n)
+  {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<uint16_t>(std::min(std::max(src[i], 0.f), 1.f) * 65535.f + 0.5f);
+  }
+
+  inline void from_fixed16(const uint16_t *src, float *dst, size_t n)
+  {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = static_cast<float>(src[i]) * (1.f / 65535.f);
+  }
+
+  // ---- feature slices ----
+
+  inline const unsigned char *column(const FeatureHdr &h, int k)
+  {
+    return reinterpret_cast<const unsigned char *>(&h + 1) + static_cast<size_t>(k) * h.col_bytes;
+  }
+
+  // Rows [i0, i0+n) of column k as raw quantized values (q, before scale and
+  // offset): the inference kernel folds the affine map into its weights.
+  inline void load_column(const FeatureHdr &h, int k, size_t i0, size_t n, float *dst)
+  {
+    if (static_cast<Format>(h.format) == Format::Int8)
+      from_int8(reinterpret_cast<const int8_t *>(column(h, k)) + i0, dst, n);
+    else
+      from_half(reinterpret_cast<const uint16_t *>(column(h, k)) + i0, dst, n);
+  }
+
+  // Encode rows feats[i * stride], i < rows, into `out` (feature_bytes(fmt,
+  // rows) bytes). Scale and offset are fitted per feature to this slice's
+  // range. Returns the bytes written.
+  inline size_t pack_features(Format fmt, const Features *feats, size_t rows, size_t stride, void *out)
+  {
+    auto &h = *static_cast<FeatureHdr *>(out);
+    h = FeatureHdr{};
+    h.ts_ms = rows ? feats[0].ts_ms : 0;
+    h.j0 = rows ? feats[0].junction : 0;
+    h.stride = static_cast<uint32_t>(stride);
+    h.rows = static_cast<uint32_t>(rows);
+    h.format = static_cast<uint32_t>(fmt);
+    h.col_bytes = static_cast<uint32_t>(column_bytes(fmt, rows));
+
+    float lo[kFeatures], hi[kFeatures];
+    for (int k = 0; k < kFeatures; ++k)
+      lo[k] = hi[k] = rows ? feats[0].f[k] : 0.f;
+    for (size_t i = 1; i < rows; ++i)
+      for (int k = 0; k < kFeatures; ++k)
+      {
+        const float x = feats[i * stride].f[k];
+        lo[k] = std::min(lo[k], x);
+        hi[k] = std::max(hi[k], x);
+      }
+    const float qmax = fmt == Format::Int8 ? 127.f : 1.f;
+    for (int k = 0; k < kFeatures; ++k)
+    {
+      const float half = 0.5f * (hi[k] - lo[k]);
+      h.offset[k] = lo[k] + half;
+      h.scale[k] = half > 0.f ? half / qmax : 1.f;
+    }
+
+    float buf[kBlock];
+    unsigned char *col0 = reinterpret_cast<unsigned char *>(&h + 1);
+    for (size_t i0 = 0; i0 < rows; i0 += kBlock)
+    {
+      const size_t n = std::min(kBlock, rows - i0);
+      for (int k = 0; k < kFeatures; ++k)
+      {
+        // Normalised to [-1, 1]; to_int8 applies the 127.
+        const float inv = 1.f / (h.scale[k] * qmax), off = h.offset[k];
+        const Features *src = feats + i0 * stride;
+        for (size_t i = 0; i < n; ++i)
+          buf[i] = (src[i * stride].f[k] - off) * inv;
+        unsigned char *col = col0 + static_cast<size_t>(k) * h.col_bytes;
+        if (fmt == Format::Int8)
+          to_int8(buf, reinterpret_cast<int8_t *>(col) + i0, n);
+        else
+          to_half(buf, reinterpret_cast<uint16_t *>(col) + i0, n);
+      }
+    }
+    return feature_bytes(fmt, rows);
+  }
+
+  // ---- prediction slices ----
+
+  inline uint16_t *pred_column(void *p) { return reinterpret_cast<uint16_t *>(static_cast<PredHdr *>(p) + 1); }
+  inline const uint16_t *pred_column(const void *p)
+  {
+    return reinterpret_cast<const uint16_t *>(static_cast<const PredHdr *>(p) + 1);
+  }
+
+  // Expand a prediction slice into `out` (PredHdr::rows entries). Returns the rows.
+  inline size_t unpack_predictions(const void *in, Prediction *out)
+  {
+    const PredHdr &h = *static_cast<const PredHdr *>(in);
+    const uint16_t *q = pred_column(in);
+    float y[kBlock];
+    for (size_t i0 = 0; i0 < h.rows; i0 += kBlock)
+    {
+      const size_t n = std::min<size_t>(kBlock, h.rows - i0);
+      from_fixed16(q + i0, y, n);
+      for (size_t i = 0; i < n; ++i)
+        out[i0 + i] = Prediction{h.ts_ms, h.j0 + static_cast<uint32_t>((i0 + i) * h.stride), y[i]};
+    }
+    return h.rows;
+  }
+} // namespace packed
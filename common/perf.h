@@ -0,0 +1,299 @@
+// common/perf.h
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "common/timers.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Per-stage hardware counters (TWIN_PERF=1, Linux perf_event_open).
+//
+// A perf::Region brackets one stage on the calling thread and adds its wall
+// time and counter deltas to a process-wide table keyed by (stage, thread).
+// Each thread opens its own counters the first time it enters a region, so
+// the OpenMP workers inside map_features / predict_batch report per thread.
+// The drivers print the table after their tick lines ([PERF] lines).
+//
+// Counters the kernel refuses (no PMU in a container, perf_event_paranoid)
+// are left out one by one and print as "-"; with none at all the table
+// still carries calls and time. Without TWIN_PERF a region is one branch.
+namespace perf
+{
+  enum Counter
+  {
+    kCycles,
+    kInstructions,
+    kLlcMisses,
+    kBranchMisses,
+    kContextSwitches,
+    kCounters
+  };
+
+  inline const char *counter_name(int c)
+  {
+    static const char *kName[kCounters] = {"cycles", "instr", "llc-miss", "br-miss", "ctx-sw"};
+    return kName[c];
+  }
+
+  inline bool enabled()
+  {
+    static const bool on = std::getenv("TWIN_PERF") && std::atoi(std::getenv("TWIN_PERF")) != 0;
+    return on;
+  }
+
+  struct Stat
+  {
+    uint64_t calls = 0;
+    uint64_t ns = 0;
+    double v[kCounters]{};
+    bool have[kCounters]{};
+
+    void add(const Stat &o)
+    {
+      calls += o.calls;
+      ns += o.ns;
+      for (int c = 0; c < kCounters; ++c)
+      {
+        v[c] += o.v[c];
+        have[c] |= o.have[c];
+      }
+    }
+  };
+
+  // This thread's counters, opened on first use and closed at thread exit.
+  class ThreadCounters
+  {
+  public:
+    ThreadCounters()
+    {
+#ifdef __linux__
+      tid_ = static_cast<int>(syscall(SYS_gettid));
+      static const std::pair<uint32_t, uint64_t> kEvent[kCounters] = {
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}, // last-level cache
+          {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+          {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+      };
+      for (int c = 0; c < kCounters; ++c)
+        fd_[c] = open_event(kEvent[c].first, kEvent[c].second);
+#else
+      static std::atomic<int> next{1};
+      tid_ = next++;
+#endif
+    }
+    ~ThreadCounters()
+    {
+#ifdef __linux__
+      for (int fd : fd_)
+        if (fd >= 0)
+          close(fd);
+#endif
+    }
+    ThreadCounters(const ThreadCounters &) = delete;
+    ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+    int tid() const { return tid_; }
+    bool has(int c) const { return fd_[c] >= 0; }
+
+    // Running totals, scaled up when the kernel multiplexed a counter.
+    void read(double *out) const
+    {
+      for (int c = 0; c < kCounters; ++c)
+      {
+        out[c] = 0.0;
+#ifdef __linux__
+        uint64_t r[3] = {0, 0, 0}; // value, time enabled, time running
+        if (fd_[c] >= 0 && ::read(fd_[c], r, sizeof(r)) == static_cast<ssize_t>(sizeof(r)))
+          out[c] = r[2] ? static_cast<double>(r[0]) * (static_cast<double>(r[1]) / static_cast<double>(r[2])) : 0.0;
+#endif
+      }
+    }
+
+    // Why the first counter could not be opened (0 when all opened).
+    static std::atomic<int> &first_errno()
+    {
+      static std::atomic<int> e{0};
+      return e;
+    }
+
+  private:
+    int fd_[kCounters] = {-1, -1, -1, -1, -1};
+    int tid_ = 0;
+
+#ifdef __linux__
+    static int open_event(uint32_t type, uint64_t config)
+    {
+      perf_event_attr a{};
+      a.size = sizeof(a);
+      a.type = type;
+      a.config = config;
+      a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      // User and kernel where allowed, user only under a stricter paranoid level.
+      for (int user_only = 0; user_only < 2; ++user_only)
+      {
+        a.exclude_kernel = user_only;
+        a.exclude_hv = 1;
+        const long fd = syscall(SYS_perf_event_open, &a, 0 /*this thread*/, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd >= 0)
+          return static_cast<int>(fd);
+      }
+      int none = 0;
+      first_errno().compare_exchange_strong(none, errno);
+      return -1;
+    }
+#endif
+  };
+
+  inline ThreadCounters &this_thread()
+  {
+    thread_local ThreadCounters tc;
+    return tc;
+  }
+
+  // Process-wide (stage, thread) -> totals.
+  class Table
+  {
+  public:
+    static Table &get()
+    {
+      static Table t;
+      return t;
+    }
+
+    void add(const char *stage, int tid, const Stat &s)
+    {
+      std::lock_guard<std::mutex> g(m_);
+      rows_[{stage, tid}].add(s);
+    }
+
+    // One line per stage (threads summed), then one per thread of stages that
+    // ran on more than one. `who` prefixes every line (e.g. "rank=2 ").
+    void print(FILE *out, const char *who = "") const
+    {
+      std::lock_guard<std::mutex> g(m_);
+      if (rows_.empty())
+        return;
+      int have = 0;
+      for (int c = 0; c < kCounters; ++c)
+      {
+        bool h = false;
+        for (const auto &kv : rows_)
+          h |= kv.second.have[c];
+        have += h;
+      }
+      if (have < kCounters)
+      {
+        const int e = ThreadCounters::first_errno().load();
+        std::fprintf(out, "[PERF] %s%s counters unavailable (%s)%s\n", who, have ? "some" : "all",
+                     e ? std::strerror(e) : "not Linux", have ? "" : ", time only");
+      }
+
+      std::map<std::string, std::pair<Stat, int>> stages; // stage -> {sum, threads}
+      for (const auto &kv : rows_)
+      {
+        auto &st = stages[kv.first.first];
+        st.first.add(kv.second);
+        st.second++;
+      }
+      for (const auto &kv : stages)
+      {
+        print_line(out, who, kv.first.c_str(), "threads", kv.second.second, kv.second.first);
+        if (kv.second.second > 1)
+          for (const auto &row : rows_)
+            if (row.first.first == kv.first)
+              print_line(out, who, kv.first.c_str(), "tid", row.first.second, row.second);
+      }
+      std::fflush(out);
+    }
+
+  private:
+    static void print_line(FILE *out, const char *who, const char *stage, const char *key, int id, const Stat &s)
+    {
+      std::fprintf(out, "[PERF] %s%-10s %s=%-6d calls=%-5llu time=%.1fms", who, stage, key, id,
+                   (unsigned long long)s.calls, s.ns / 1e6);
+      for (int c = 0; c < kCounters; ++c)
+      {
+        if (!s.have[c])
+          std::fprintf(out, " %s=-", counter_name(c));
+        else
+          std::fprintf(out, " %s=%.3g", counter_name(c), s.v[c]);
+        if (c == kInstructions)
+        {
+          if (s.have[kCycles] && s.have[kInstructions] && s.v[kCycles] > 0)
+            std::fprintf(out, " ipc=%.2f", s.v[kInstructions] / s.v[kCycles]);
+          else
+            std::fprintf(out, " ipc=-");
+        }
+      }
+      std::fprintf(out, "\n");
+    }
+
+    mutable std::mutex m_;
+    std::map<std::pair<std::string, int>, Stat> rows_;
+  };
+
+  // Scoped stage region on the calling thread.
+  class Region
+  {
+  public:
+    explicit Region(const char *stage) : stage_(stage), on_(enabled())
+    {
+      if (!on_)
+        return;
+      this_thread().read(v0_);
+      ns0_ = now_ns();
+    }
+    ~Region()
+    {
+      if (!on_)
+        return;
+      const uint64_t ns1 = now_ns();
+      ThreadCounters &tc = this_thread();
+      double v1[kCounters];
+      tc.read(v1);
+      Stat s;
+      s.calls = 1;
+      s.ns = ns1 - ns0_;
+      for (int c = 0; c < kCounters; ++c)
+      {
+        s.have[c] = tc.has(c);
+        s.v[c] = v1[c] - v0_[c];
+      }
+      Table::get().add(stage_, tc.tid(), s);
+    }
+    Region(const Region &) = delete;
+    Region &operator=(const Region &) = delete;
+
+  private:
+    static uint64_t now_ns()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    const char *stage_;
+    bool on_;
+    uint64_t ns0_ = 0;
+    double v0_[kCounters]{};
+  };
+
+  // After the tick lines, on the same stream.
+  inline void report(FILE *out = stdout, const char *who = "")
+  {
+    if (enabled())
+      Table::get().print(out, who);
+  }
+} // namespace perf
@@ -0,0 +1,87 @@
+// common/results.h
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/log.h"
+
+// Run summary in one shape for every driver (--results=PATH): a single flat
+// JSON object with the scenario, what the driver adds (ranks, predictors,
+// ...) and per-tick latency statistics. tools/sweep.py turns a directory of
+// these into one CSV row each.
+class RunResults
+{
+public:
+  explicit RunResults(const TwinConfig &c) : cfg_(c) { lat_ms_.reserve(c.ticks); }
+
+  // One completed tick: its latency, predictions acted on, and whether it
+  // missed its deadline.
+  void tick(double lat_ms, size_t preds, bool miss)
+  {
+    lat_ms_.push_back(lat_ms);
+    preds_ += preds;
+    misses_ += miss;
+  }
+
+  // seq runs ticks back to back rather than on the tick period.
+  void unpaced() { paced_ = false; }
+
+  // Driver-specific fields (numbers only), written after the common ones.
+  void set(const char *key, double v) { extra_.emplace_back(key, v); }
+
+  // No-op without --results. Returns false if the file cannot be written.
+  bool write() const
+  {
+    if (cfg_.results.empty())
+      return true;
+    FILE *f = std::fopen(cfg_.results.c_str(), "w");
+    if (!f)
+    {
+      std::fprintf(stderr, "[RESULTS] cannot write %s\n", cfg_.results.c_str());
+      return false;
+    }
+    std::vector<double> s = lat_ms_;
+    std::sort(s.begin(), s.end());
+    const size_t n = s.size();
+    double sum = 0.0;
+    for (double x : s)
+      sum += x;
+    auto pct = [&](double p)
+    { return n ? s[std::min(n - 1, static_cast<size_t>(p * (n - 1) + 0.5))] : 0.0; };
+    const double mean = n ? sum / n : 0.0;
+    const double preds = n ? static_cast<double>(preds_) / n : 0.0;
+
+    std::fprintf(f, "{\"variant\": \"%s\", \"junctions\": %u, \"lanes\": \"%s\", \"ticks\": %u, \"tick_ms\": %u",
+                 cfg_.variant, cfg_.junctions, cfg_.lanes_file.empty() ? cfg_.lanes.c_str() : "file",
+                 cfg_.ticks, cfg_.tick_ms);
+    std::fprintf(f, ", \"budget_pred_ms\": %u, \"budget_ctrl_ms\": %u, \"threads\": %d, \"model\": \"%s\"",
+                 cfg_.budget_pred_ms, cfg_.budget_ctrl_ms, cfg_.team(), cfg_.opencl ? "opencl" : "cpu");
+    std::fprintf(f, ", \"win_short\": %u, \"win_long\": %u", cfg_.win_short, cfg_.win_long);
+    for (const auto &[k, v] : extra_)
+      std::fprintf(f, ", \"%s\": %.17g", k.c_str(), v);
+    std::fprintf(f, ", \"ticks_done\": %zu, \"lat_mean_ms\": %.3f, \"lat_p50_ms\": %.3f, \"lat_p95_ms\": %.3f", n, mean,
+                 pct(0.50), pct(0.95));
+    std::fprintf(f, ", \"lat_max_ms\": %.3f, \"miss_ratio\": %.4f, \"preds_per_tick\": %.1f", n ? s.back() : 0.0,
+                 n ? static_cast<double>(misses_) / n : 0.0, preds);
+    // Junctions decided per second: one tick per period, or per latency when
+    // unpaced or when ticks overrun the period.
+    const double per_tick = paced_ ? std::max(mean, static_cast<double>(cfg_.tick_ms)) : mean;
+    std::fprintf(f, ", \"junctions_per_s\": %.1f, \"peak_rss_mb\": %.1f}\n",
+                 per_tick > 0 ? preds * 1000.0 / per_tick : 0.0, peak_rss_bytes() / 1048576.0);
+    std::fclose(f);
+    return true;
+  }
+
+private:
+  const TwinConfig &cfg_;
+  std::vector<double> lat_ms_;
+  size_t preds_ = 0;
+  size_t misses_ = 0;
+  bool paced_ = true;
+  std::vector<std::pair<std::string, double>> extra_;
+};
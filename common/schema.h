@@ -2,13 +2,18 @@
 #pragma once
 #include <cstdint>
 
-constexpr int MAX_FEATURES = 16;
+constexpr int MAX_FEATURES = 18;
+
+// Junction ids are 32-bit so one twin can hold a whole metro region. Every
+// record below keeps its 32-bit fields first and packs the narrow ones after
+// them, so the wider id fills what used to be padding and no record grows
+// (sizes pinned at the bottom: they are the MPI / shared-memory wire format).
 
 // SensorSample: compact, POD, suitable for MPI raw sends.
 struct SensorSample
 {
   uint32_t ts_ms; // steady-clock ms domain
-  uint16_t junction;
+  uint32_t junction;
   uint16_t lane;
   uint16_t q_len;     // vehicles queued
   uint16_t arrivals;  // vehicles/s *10
@@ -18,27 +23,28 @@ struct SensorSample
 struct Features
 {
   uint32_t ts_ms; // propagated tick time
-  uint16_t junction;
+  uint32_t junction;
   float f[MAX_FEATURES]; // feature vector
 };
 
 struct Prediction
 {
   uint32_t ts_ms;
-  uint16_t junction;
+  uint32_t junction;
   float congestion_60s; // 0..1
 };
 
 struct PhaseCmd
 {
   uint32_t ts_ms;
-  uint16_t junction;
+  uint32_t junction;
   uint8_t phase_id;
   uint8_t delta_sec;
   uint8_t reason; // 0=MODEL,1=HEUR
 };
 
-// Basic layout sanity checks (not ABI guarantees, but catches accidental changes)
-static_assert(sizeof(SensorSample) >= 12, "SensorSample unexpectedly small");
-static_assert(sizeof(Features) >= 4 + 2 + sizeof(float) * MAX_FEATURES, "Features size mismatch");
-static_assert(sizeof(Prediction) >= 4 + 2 + 4, "Prediction size mismatch");
\ No newline at end of file
+// Wire sizes: a failure here means a field change made a record grow.
+static_assert(sizeof(SensorSample) == 16, "SensorSample size changed");
+static_assert(sizeof(Features) == 8 + sizeof(float) * MAX_FEATURES, "Features size changed");
+static_assert(sizeof(Prediction) == 12, "Prediction size changed");
+static_assert(sizeof(PhaseCmd) == 12, "PhaseCmd size changed");
\ No newline at end of file
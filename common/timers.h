@@ -14,6 +14,14 @@ using TimePoint = std::chrono::time_point<Clock>;
       .count();
 }
 
+// Microsecond steady clock for short intervals (e.g. per-slice throughput).
+[[nodiscard]] inline uint64_t now_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
 // Sleep until a steady-clock millisecond timestamp (same domain as now_ms()).
 // Uses a short spin+yield near the target to reduce oversleep jitter on macOS.
 inline void sleep_until_ms(uint64_t target_ms)
@@ -0,0 +1,248 @@
+// control/cmd_stream.cpp
+#include "control/cmd_stream.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "common/timers.h"
+
+namespace
+{
+  uint32_t env_u32(const char *var, uint32_t dflt)
+  {
+    const char *e = std::getenv(var);
+    return e && *e ? static_cast<uint32_t>(std::strtoul(e, nullptr, 10)) : dflt;
+  }
+
+  // What a junction was last told, +1 so that 0 means "nothing sent yet".
+  inline uint32_t cmd_key(const PhaseCmd &c)
+  {
+    return (static_cast<uint32_t>(c.phase_id) | static_cast<uint32_t>(c.delta_sec) << 8 |
+            static_cast<uint32_t>(c.reason) << 16) + 1u;
+  }
+} // namespace
+
+std::unique_ptr<CmdStream> CmdStream::from_env(uint32_t junctions)
+{
+  const char *path = std::getenv("TWIN_CMDS");
+  if (!path || !*path)
+    return nullptr;
+  auto s = std::make_unique<CmdStream>(path, junctions, std::max(2u, env_u32("TWIN_CMDS_SLOTS", 8)),
+                                       env_u32("TWIN_CMDS_DELTA", 0));
+  if (!s->ok())
+    return nullptr;
+  return s;
+}
+
+CmdStream::CmdStream(const std::string &path, uint32_t junctions, uint32_t slots, uint32_t keyframe)
+    : path_(path), junctions_(junctions), slots_(slots), keyframe_(keyframe)
+{
+  slot_bytes_ = (sizeof(CmdTickHdr) + static_cast<size_t>(junctions) * sizeof(PhaseCmd) + 63) & ~size_t(63);
+  map_bytes_ = sizeof(CmdFileHdr) + slot_bytes_ * slots_;
+
+  // A fresh inode every run: readers still mapping the previous file keep
+  // their (now frozen) view instead of faulting on a truncated one.
+  ::unlink(path.c_str());
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(map_bytes_)) != 0)
+  {
+    std::perror(("[CMDS] " + path).c_str());
+    if (fd >= 0)
+      ::close(fd);
+    return;
+  }
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE; // fault the ring in now, not on the first ticks
+#endif
+  void *p = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, flags, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED)
+  {
+    std::perror(("[CMDS] mmap " + path).c_str());
+    return;
+  }
+  base_ = static_cast<unsigned char *>(p);
+
+  auto *fh = new (base_) CmdFileHdr{};
+  fh->version = kCmdVersion;
+  fh->slots = slots_;
+  fh->max_cmds = junctions_;
+  fh->junctions = junctions_;
+  fh->slot_bytes = slot_bytes_;
+  for (uint32_t s = 0; s < slots_; ++s)
+    new (slot(s)) CmdTickHdr{};
+  // Readers check the magic before anything else.
+  std::atomic_thread_fence(std::memory_order_release);
+  fh->magic = kCmdMagic;
+
+  if (keyframe_)
+    last_.assign(junctions_, 0);
+  pending_.reserve(junctions_);
+  work_.reserve(junctions_);
+  diff_.reserve(junctions_);
+  if (keyframe_)
+    std::fprintf(stderr, "[CMDS] %s slots=%u slot=%zuB delta, keyframe every %u ticks\n", path_.c_str(), slots_,
+                 slot_bytes_, keyframe_);
+  else
+    std::fprintf(stderr, "[CMDS] %s slots=%u slot=%zuB full ticks\n", path_.c_str(), slots_, slot_bytes_);
+  th_ = std::thread([this]
+                    { run(); });
+}
+
+CmdStream::~CmdStream()
+{
+  if (!base_)
+    return;
+  {
+    std::lock_guard<std::mutex> g(m_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  th_.join();
+  std::fprintf(stderr, "[CMDS] %s ticks=%llu dropped=%llu cmds/tick=%.0f of %.0f\n", path_.c_str(),
+               (unsigned long long)next_, (unsigned long long)dropped_, next_ ? (double)cmds_out_ / next_ : 0.0,
+               next_ ? (double)cmds_in_ / next_ : 0.0);
+  ::munmap(base_, map_bytes_);
+}
+
+CmdTickHdr *CmdStream::slot(uint64_t n) const
+{
+  return reinterpret_cast<CmdTickHdr *>(base_ + sizeof(CmdFileHdr) + (n % slots_) * slot_bytes_);
+}
+
+void CmdStream::publish(uint32_t tick_id, uint32_t src_tick, std::vector<PhaseCmd> &cmds, bool mixed)
+{
+  {
+    std::lock_guard<std::mutex> g(m_);
+    dropped_ += has_pending_;
+    std::swap(cmds, pending_);
+    pending_tick_ = tick_id;
+    pending_src_ = src_tick;
+    pending_mixed_ = mixed;
+    has_pending_ = true;
+  }
+  cv_.notify_one();
+  cmds.clear();
+}
+
+void CmdStream::run()
+{
+  for (;;)
+  {
+    uint32_t tick_id = 0, src_tick = 0;
+    bool mixed = false;
+    {
+      std::unique_lock<std::mutex> lk(m_);
+      cv_.wait(lk, [&]
+               { return has_pending_ || stop_; });
+      if (!has_pending_)
+        return;
+      std::swap(work_, pending_);
+      tick_id = pending_tick_;
+      src_tick = pending_src_;
+      mixed = pending_mixed_;
+      has_pending_ = false;
+    }
+    write_tick(tick_id, src_tick, mixed, work_);
+  }
+}
+
+void CmdStream::write_tick(uint32_t tick_id, uint32_t src_tick, bool mixed, const std::vector<PhaseCmd> &cmds)
+{
+  const uint64_t n = next_++;
+  const bool full = keyframe_ == 0 || n % keyframe_ == 0;
+  const PhaseCmd *src = cmds.data();
+  size_t count = cmds.size();
+  if (keyframe_)
+  {
+    // Diff against what each junction was last told; keyframes refresh it too.
+    diff_.clear();
+    for (const PhaseCmd &c : cmds)
+    {
+      if (c.junction >= junctions_)
+        continue;
+      const uint32_t k = cmd_key(c);
+      if (last_[c.junction] != k)
+      {
+        last_[c.junction] = k;
+        if (!full)
+          diff_.push_back(c);
+      }
+    }
+    if (!full)
+    {
+      src = diff_.data();
+      count = diff_.size();
+    }
+  }
+  count = std::min<size_t>(count, junctions_);
+
+  CmdTickHdr *h = slot(n);
+  h->seq.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  h->tick_id = tick_id;
+  h->ts_ms = cmds.empty() ? 0 : cmds.front().ts_ms;
+  h->count = static_cast<uint32_t>(count);
+  h->flags = (full ? kCmdFull : kCmdDelta) | (mixed ? kCmdMixed : 0u);
+  h->decided = static_cast<uint32_t>(cmds.size());
+  h->src_tick = src_tick;
+  if (count)
+    std::memcpy(reinterpret_cast<PhaseCmd *>(h + 1), src, count * sizeof(PhaseCmd));
+  h->publish_us = now_us();
+  h->seq.store(2 * n + 2, std::memory_order_release);
+  reinterpret_cast<CmdFileHdr *>(base_)->published.store(n + 1, std::memory_order_release);
+  cmds_out_ += count;
+  cmds_in_ += cmds.size();
+}
+
+CmdStreamReader::CmdStreamReader(const std::string &path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  CmdFileHdr fh;
+  if (::pread(fd, &fh, sizeof(fh), 0) != static_cast<ssize_t>(sizeof(fh)) || fh.magic != kCmdMagic ||
+      fh.version != kCmdVersion)
+  {
+    ::close(fd);
+    return;
+  }
+  map_bytes_ = sizeof(CmdFileHdr) + fh.slot_bytes * fh.slots;
+  void *p = ::mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED)
+    return;
+  base_ = static_cast<const unsigned char *>(p);
+  hdr_ = reinterpret_cast<const CmdFileHdr *>(base_);
+}
+
+CmdStreamReader::~CmdStreamReader()
+{
+  if (base_)
+    ::munmap(const_cast<unsigned char *>(base_), map_bytes_);
+}
+
+bool CmdStreamReader::view(uint64_t n, CmdTickView &v) const
+{
+  const uint64_t pub = published();
+  if (n >= pub || pub - n > hdr_->slots)
+    return false;
+  const auto *h =
+      reinterpret_cast<const CmdTickHdr *>(base_ + sizeof(CmdFileHdr) + (n % hdr_->slots) * hdr_->slot_bytes);
+  const uint64_t seq = h->seq.load(std::memory_order_acquire);
+  if (seq != 2 * n + 2)
+    return false;
+  v = CmdTickView{n, seq, h, reinterpret_cast<const PhaseCmd *>(h + 1), std::min(h->count, hdr_->max_cmds)};
+  return true;
+}
+
+bool CmdStreamReader::still_valid(const CmdTickView &v) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return v.hdr->seq.load(std::memory_order_relaxed) == v.seq;
+}
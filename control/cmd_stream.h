@@ -0,0 +1,166 @@
+// control/cmd_stream.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/schema.h"
+
+// Memory-mapped PhaseCmd output stream (TWIN_CMDS=<path>).
+//
+// Each tick's commands are published into a ring of fixed-size slots in a
+// shared file mapping. Any number of local processes map the same file
+// read-only and read ticks in place: no copies, no syscalls after mmap, and
+// nothing they do can stall the writer.
+//
+//   [CmdFileHdr 64 B][slot 0][slot 1]...[slot slots-1]
+//   slot = [CmdTickHdr 64 B][PhaseCmd x max_cmds]
+//
+// Publication n (0, 1, 2, ...) goes to slot n % slots under a per-slot
+// sequence lock: `seq` is 2n+1 while the slot is being written and 2n+2 once
+// it is complete, and the file header's `published` is bumped to n+1 after
+// that. A reader that sees the same even `seq` before and after reading has
+// a consistent tick; anything else means the writer lapped it.
+//
+// A tick's header carries two tick ids. `tick_id` is the controller tick
+// that published it (0, 1, 2, ... in publication order). `src_tick` is the
+// tick whose predictions the commands were decided from: the same tick in
+// seq, smp and chunked dist, but older under DIST_PIPE / DIST_RMA, and
+// kCmdNoSource when no slice arrived. kCmdMixed marks a tick that also holds
+// commands derated from older rows (missing DIST_HEDGE slices).
+//
+// With TWIN_CMDS_DELTA=K a tick carries only the junctions whose command
+// (phase, delta, reason) changed since the last published tick, and every
+// K-th tick is a full keyframe so a late reader can start from a known state.
+//
+// The driver hands a tick over with publish(), which swaps vectors; the
+// diff and the copy into the mapping run on the stream's own thread.
+struct CmdFileHdr
+{
+  uint64_t magic; // kCmdMagic, stored last at creation
+  uint32_t version;
+  uint32_t slots;
+  uint32_t max_cmds;  // PhaseCmd capacity of a slot (junction count)
+  uint32_t junctions;
+  uint64_t slot_bytes; // slot stride, including its CmdTickHdr
+  std::atomic<uint64_t> published; // ticks published so far
+  uint8_t pad[24];
+};
+
+struct CmdTickHdr
+{
+  std::atomic<uint64_t> seq; // sequence lock (see above)
+  uint32_t tick_id;  // controller tick (see above)
+  uint32_t ts_ms;
+  uint32_t count;     // PhaseCmds that follow
+  uint32_t flags;     // kCmdFull | kCmdDelta, plus kCmdMixed
+  uint64_t publish_us; // steady clock (now_us()) when the slot was sealed
+  uint32_t decided;    // commands the controller produced this tick
+  uint32_t src_tick;   // tick the predictions came from (see above)
+  uint8_t pad[24];
+};
+
+static_assert(sizeof(CmdFileHdr) == 64 && sizeof(CmdTickHdr) == 64, "cache-line headers");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seq lock must be address-free");
+
+constexpr uint64_t kCmdMagic = 0x31444d434e495754ull; // "TWINCMD1"
+constexpr uint32_t kCmdVersion = 2;
+constexpr uint32_t kCmdFull = 1;  // every decided command (keyframe)
+constexpr uint32_t kCmdDelta = 2; // only commands that changed
+constexpr uint32_t kCmdMixed = 4; // some commands derated from older ticks' rows
+constexpr uint32_t kCmdNoSource = 0xffffffffu; // src_tick when nothing arrived
+
+// A tick as seen by a reader: pointers into the mapping, valid until the
+// writer laps the slot (check with CmdStreamReader::still_valid()).
+struct CmdTickView
+{
+  uint64_t n = 0; // publication number
+  uint64_t seq = 0;
+  const CmdTickHdr *hdr = nullptr;
+  const PhaseCmd *cmds = nullptr;
+  uint32_t count = 0;
+};
+
+class CmdStream
+{
+public:
+  // TWIN_CMDS=<path> enables the stream (nullptr otherwise);
+  // TWIN_CMDS_SLOTS=<n> ring depth in ticks (default 8);
+  // TWIN_CMDS_DELTA=<k> changed-only ticks with a keyframe every k (0 = off).
+  static std::unique_ptr<CmdStream> from_env(uint32_t junctions);
+
+  CmdStream(const std::string &path, uint32_t junctions, uint32_t slots, uint32_t keyframe);
+  ~CmdStream(); // drains the last hand-off, prints a [CMDS] line
+  CmdStream(const CmdStream &) = delete;
+  CmdStream &operator=(const CmdStream &) = delete;
+
+  [[nodiscard]] bool ok() const { return base_ != nullptr; }
+
+  // Hand this tick's commands to the stream thread. `cmds` is swapped with a
+  // recycled buffer and comes back empty. If the thread has not picked up
+  // the previous tick yet, that tick is replaced (counted as dropped).
+  // `tick_id` is the controller tick, `src_tick` the tick decided from.
+  void publish(uint32_t tick_id, uint32_t src_tick, std::vector<PhaseCmd> &cmds, bool mixed = false);
+
+private:
+  void run();
+  void write_tick(uint32_t tick_id, uint32_t src_tick, bool mixed, const std::vector<PhaseCmd> &cmds);
+  CmdTickHdr *slot(uint64_t n) const;
+
+  std::string path_;
+  uint32_t junctions_;
+  uint32_t slots_;
+  uint32_t keyframe_;
+  size_t slot_bytes_ = 0;
+  size_t map_bytes_ = 0;
+  unsigned char *base_ = nullptr;
+
+  // Hand-off (one pending tick) to the stream thread.
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::vector<PhaseCmd> pending_;
+  uint32_t pending_tick_ = 0;
+  uint32_t pending_src_ = 0;
+  bool pending_mixed_ = false;
+  bool has_pending_ = false;
+  bool stop_ = false;
+  std::thread th_;
+
+  // Stream thread state.
+  std::vector<PhaseCmd> work_;
+  std::vector<uint32_t> last_; // per junction: packed (phase, delta, reason) + 1, 0 = never sent
+  std::vector<PhaseCmd> diff_;
+  uint64_t next_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t cmds_out_ = 0;
+  uint64_t cmds_in_ = 0;
+};
+
+// Read side, for consumers in C++ (tools/read_cmds.py is the same in Python).
+class CmdStreamReader
+{
+public:
+  explicit CmdStreamReader(const std::string &path);
+  ~CmdStreamReader();
+  CmdStreamReader(const CmdStreamReader &) = delete;
+  CmdStreamReader &operator=(const CmdStreamReader &) = delete;
+
+  [[nodiscard]] bool ok() const { return hdr_ != nullptr; }
+  [[nodiscard]] const CmdFileHdr &header() const { return *hdr_; }
+  [[nodiscard]] uint64_t published() const { return hdr_->published.load(std::memory_order_acquire); }
+
+  // Publication `n` if it is still in the ring (n < published()).
+  bool view(uint64_t n, CmdTickView &v) const;
+  // After reading v's commands: true if the writer did not overwrite them.
+  bool still_valid(const CmdTickView &v) const;
+
+private:
+  const CmdFileHdr *hdr_ = nullptr;
+  const unsigned char *base_ = nullptr;
+  size_t map_bytes_ = 0;
+};
@@ -22,7 +22,7 @@ namespace
   }
 
   // Simple 4-phase ring
-  inline uint8_t next_phase_for_delta(uint16_t junction, int delta)
+  inline uint8_t next_phase_for_delta(uint32_t junction, int delta)
   {
     // If we’re “lengthening”, bias to next phase; otherwise keep current mapping
     uint8_t phase = static_cast<uint8_t>(junction % 4);
@@ -40,13 +40,23 @@ void Controller::decide(const std::vector<Prediction> &preds,
 {
   out_cmds.clear();
   out_cmds.reserve(preds.size());
+  decide_append(preds.data(), preds.size(), 1, out_cmds, predictions_complete);
 
+  // NOTE: We deliberately do not sort cmds so output order matches preds input.
+  // If you prefer top-heavy logs, you could sort by highest congestion here.
+}
+
+void Controller::decide_append(const Prediction *preds, size_t n, size_t stride,
+                               std::vector<PhaseCmd> &out_cmds,
+                               bool predictions_complete)
+{
   // Heuristic de-rate when predictions are incomplete (noise/partial coverage)
   const int derate_pct = predictions_complete ? 100 : std::clamp<int>(cfg_.heuristic_derate_pct, 0, 100);
   const uint8_t reason = predictions_complete ? 0 /*MODEL*/ : 1 /*HEUR*/;
 
-  for (const auto &p : preds)
+  for (size_t i = 0; i < n; ++i)
   {
+    const Prediction &p = preds[i * stride];
     // 1) compute signed delta
     int raw = congestion_to_delta(p.congestion_60s, cfg_.max_delta_per_tick);
     // 2) apply derate if incomplete
@@ -66,7 +76,4 @@ void Controller::decide(const std::vector<Prediction> &preds,
         delta_sec,
         reason});
   }
-
-  // NOTE: We deliberately do not sort cmds so output order matches preds input.
-  // If you prefer top-heavy logs, you could sort by highest congestion here.
-}
\ No newline at end of file
+}
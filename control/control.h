@@ -1,6 +1,7 @@
 // control/control.h
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include "common/schema.h"
 
@@ -22,6 +23,12 @@ public:
   void decide(const std::vector<Prediction> &preds,
               std::vector<PhaseCmd> &out_cmds,
               bool predictions_complete);
+  // Append commands for a strided view over n predictions (preds[i * stride]).
+  // Used by the dist controller to decide straight out of the junction-indexed
+  // RMA table without first gathering into a contiguous vector.
+  void decide_append(const Prediction *preds, size_t n, size_t stride,
+                     std::vector<PhaseCmd> &out_cmds,
+                     bool predictions_complete);
 
 private:
   CtrlConfig cfg_;
@@ -0,0 +1,71 @@
+// dist/balance.cpp
+#include "dist/balance.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr double kMinShare = 0.1; // of an even share
+}
+
+SliceBalancer::SliceBalancer(int predictors, float alpha, float hysteresis)
+    : alpha_(alpha), hysteresis_(hysteresis),
+      cap_(std::max(1, predictors), 0.0),
+      share_(std::max(1, predictors), 1.0 / std::max(1, predictors)) {}
+
+void SliceBalancer::report(int p, uint32_t n, uint32_t elapsed_us)
+{
+  if (p < 0 || p >= (int)cap_.size() || n == 0)
+    return;
+  const double rate = (double)n * 1000.0 / (double)std::max<uint32_t>(elapsed_us, 1);
+  cap_[p] = (cap_[p] == 0.0) ? rate : alpha_ * rate + (1.0 - alpha_) * cap_[p];
+}
+
+bool SliceBalancer::cut(int total, std::vector<int> &bounds)
+{
+  const int P = (int)cap_.size();
+
+  // Ranks that have not reported yet count as average capacity.
+  double known = 0.0;
+  int nknown = 0;
+  for (double c : cap_)
+    if (c > 0.0)
+    {
+      known += c;
+      ++nknown;
+    }
+  bool moved = false;
+  if (nknown > 0)
+  {
+    const double fill = known / nknown;
+    double sum = 0.0;
+    std::vector<double> want(P);
+    for (int p = 0; p < P; ++p)
+      sum += (want[p] = (cap_[p] > 0.0) ? cap_[p] : fill);
+    // Floor every share so a starved rank still gets work and keeps
+    // reporting (otherwise it could never win its share back).
+    const double floor = kMinShare / P;
+    double norm = 0.0;
+    for (int p = 0; p < P; ++p)
+      norm += (want[p] = std::max(want[p] / sum, floor));
+    double drift = 0.0;
+    for (int p = 0; p < P; ++p)
+      drift = std::max(drift, std::fabs(want[p] / norm - share_[p]));
+    if (drift > hysteresis_)
+    {
+      for (int p = 0; p < P; ++p)
+        share_[p] = want[p] / norm;
+      moved = true;
+    }
+  }
+
+  bounds.resize(P + 1);
+  bounds[0] = 0;
+  double acc = 0.0;
+  for (int p = 0; p < P; ++p)
+  {
+    acc += share_[p];
+    bounds[p + 1] = (p == P - 1) ? total : std::min(total, (int)std::lround(acc * total));
+  }
+  return moved;
+}
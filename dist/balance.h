@@ -0,0 +1,33 @@
+// dist/balance.h
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Sizes predictor slices in proportion to each rank's measured throughput
+// (junctions per ms of predict time), smoothed with an EWMA so a slowed rank
+// is rebalanced within a few ticks.
+//
+// Slices stay contiguous and in rank order along the junction axis, so a
+// re-cut only moves the junctions near each boundary; a hysteresis band
+// keeps boundaries still while shares drift by less than `hysteresis`, which
+// keeps junction-to-rank affinity (and the predictors' caches) stable.
+class SliceBalancer
+{
+public:
+  explicit SliceBalancer(int predictors, float alpha = 0.4f, float hysteresis = 0.05f);
+
+  // Throughput report from predictor p (0-based): n junctions in elapsed_us.
+  void report(int p, uint32_t n, uint32_t elapsed_us);
+
+  // Cut [0, total) into one contiguous range per predictor:
+  // predictor p gets [bounds[p], bounds[p+1]). Returns true if shares moved.
+  bool cut(int total, std::vector<int> &bounds);
+
+  [[nodiscard]] double capacity(int p) const { return cap_[p]; }
+  [[nodiscard]] double share(int p) const { return share_[p]; }
+
+private:
+  float alpha_, hysteresis_;
+  std::vector<double> cap_;   // smoothed junctions/ms (0 = no report yet)
+  std::vector<double> share_; // committed fraction of the tick per predictor
+};
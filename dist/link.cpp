@@ -0,0 +1,128 @@
+// dist/link.cpp
+#include "dist/link.h"
+#include "dist/shm_channel.h"
+#include <cstring>
+
+namespace
+{
+  constexpr size_t kHdr = sizeof(FrameHdr);
+}
+
+TxLink::TxLink(int dst, int tag, size_t elem, size_t cap, int depth, ShmChannel *shm)
+    : dst_(dst), tag_(tag), elem_(elem), cap_(cap), shm_(shm), slots_(depth < 1 ? 1 : depth)
+{
+  for (auto &s : slots_)
+    s.buf.resize(kHdr + elem_ * cap_);
+}
+
+TxLink::~TxLink() { flush(); }
+
+void *TxLink::acquire()
+{
+  Slot &s = slots_[next_];
+  MPI_Wait(&s.req, MPI_STATUS_IGNORE); // no-op unless this buffer is still in flight
+  shm_payload_ = shm_ ? shm_->try_acquire() : nullptr;
+  in_slot_ = (shm_payload_ != nullptr);
+  return in_slot_ ? shm_payload_ : s.buf.data() + kHdr;
+}
+
+void TxLink::send(uint32_t tick_id, uint32_t n, uint32_t deadline_ms, uint16_t slice, uint16_t flags)
+{
+  Slot &s = slots_[next_];
+  const FrameHdr h{tick_id, n, deadline_ms, slice, static_cast<uint16_t>(flags | (in_slot_ ? kFrameInSlot : 0u))};
+  std::memcpy(s.buf.data(), &h, kHdr);
+  if (in_slot_)
+    shm_->publish();
+  const size_t bytes = kHdr + (in_slot_ ? 0 : elem_ * n);
+  MPI_Isend(s.buf.data(), static_cast<int>(bytes), MPI_BYTE, dst_, tag_, MPI_COMM_WORLD, &s.req);
+  next_ = (next_ + 1) % slots_.size();
+  in_slot_ = false;
+}
+
+void TxLink::flush()
+{
+  for (auto &s : slots_)
+    MPI_Wait(&s.req, MPI_STATUS_IGNORE);
+}
+
+RxLink::RxLink(int src, int tag, size_t elem, size_t cap, int depth, ShmChannel *shm)
+    : src_(src), tag_(tag), elem_(elem), cap_(cap), shm_(shm), slots_(depth < 1 ? 1 : depth)
+{
+  for (auto &s : slots_)
+  {
+    s.buf.resize(kHdr + elem_ * cap_);
+    post(s);
+  }
+}
+
+RxLink::~RxLink()
+{
+  for (auto &s : slots_)
+    if (s.req != MPI_REQUEST_NULL)
+    {
+      MPI_Cancel(&s.req);
+      MPI_Wait(&s.req, MPI_STATUS_IGNORE);
+    }
+}
+
+void RxLink::post(Slot &s)
+{
+  s.done = false;
+  s.payload = nullptr;
+  MPI_Irecv(s.buf.data(), static_cast<int>(s.buf.size()), MPI_BYTE, src_, tag_, MPI_COMM_WORLD, &s.req);
+}
+
+size_t RxLink::ready()
+{
+  // Frames complete in order, so stop at the first one still pending.
+  while (ready_ < slots_.size())
+  {
+    Slot &s = slots_[(head_ + ready_) % slots_.size()];
+    if (!s.done)
+    {
+      int flag = 0;
+      MPI_Test(&s.req, &flag, MPI_STATUS_IGNORE);
+      if (!flag)
+        break;
+      s.done = true;
+      const auto *h = reinterpret_cast<const FrameHdr *>(s.buf.data());
+      if (h->flags & kFrameInSlot)
+        s.payload = shm_->peek(shm_ready_++);
+      else
+        s.payload = s.buf.data() + kHdr;
+    }
+    ++ready_;
+  }
+  return ready_;
+}
+
+void RxLink::wait()
+{
+  // A request completed by MPI_Wait becomes MPI_REQUEST_NULL, which
+  // MPI_Test in ready() then reports as complete.
+  while (ready() == 0)
+    MPI_Wait(&slots_[head_].req, MPI_STATUS_IGNORE);
+}
+
+const FrameHdr &RxLink::hdr(size_t i) const
+{
+  return *reinterpret_cast<const FrameHdr *>(slots_[(head_ + i) % slots_.size()].buf.data());
+}
+
+const void *RxLink::payload(size_t i) const
+{
+  return slots_[(head_ + i) % slots_.size()].payload;
+}
+
+void RxLink::pop()
+{
+  Slot &s = slots_[head_];
+  if (hdr(0).flags & kFrameInSlot)
+  {
+    shm_->release();
+    --shm_ready_;
+  }
+  post(s);
+  head_ = (head_ + 1) % slots_.size();
+  --ready_;
+}
@@ -0,0 +1,108 @@
+// dist/link.h
+#pragma once
+#include <mpi.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ShmChannel;
+
+// Every dist hop (Ing->Agg, Agg->Pred, Pred->Ctrl) moves self-describing
+// frames: a FrameHdr followed by `n` payload records in the same message.
+// Frames from one source arrive in order, so a receiver can keep several
+// receives pre-posted and a sender several sends in flight.
+struct FrameHdr
+{
+  uint32_t tick_id;
+  uint32_t n;           // payload records (bytes on DIST_PACK hops)
+  uint32_t deadline_ms; // low 32 bits of now_ms() after which the tick is stale (0 = none)
+  uint16_t slice;       // slice of the tick this frame carries (Agg->Pred->Ctrl)
+  uint16_t flags;
+};
+inline constexpr uint16_t kFrameInSlot = 1u;  // payload sits in the ShmChannel slot
+inline constexpr uint16_t kFrameHedge = 2u;   // redundant copy of another rank's slice
+inline constexpr uint16_t kFrameEnd = 4u;     // end of stream, no payload
+inline constexpr uint16_t kFrameTickEnd = 8u; // chunked ticks: last frame of a tick on this hop
+inline constexpr uint16_t kFramePartial = 16u; // anytime predictor stopped at its budget: hottest rows only
+
+// Sending end of a hop with up to `depth` frames in flight (MPI_Isend).
+// Producers write the payload in place: into the shared-memory slot when a
+// local channel has one free, otherwise into the frame's own send buffer.
+class TxLink
+{
+public:
+  TxLink(int dst, int tag, size_t elem, size_t cap, int depth, ShmChannel *shm = nullptr);
+  ~TxLink();
+  TxLink(const TxLink &) = delete;
+  TxLink &operator=(const TxLink &) = delete;
+
+  // Payload area for up to `cap` records. Blocks only when all `depth`
+  // frames are still in flight (the receiver has fallen `depth` ticks behind).
+  void *acquire();
+  template <typename T>
+  T *acquire() { return static_cast<T *>(acquire()); }
+
+  // Ship the acquired frame.
+  void send(uint32_t tick_id, uint32_t n, uint32_t deadline_ms, uint16_t slice = 0, uint16_t flags = 0);
+
+  // Wait for every frame in flight to be received.
+  void flush();
+
+private:
+  struct Slot
+  {
+    std::vector<unsigned char> buf; // FrameHdr + payload
+    MPI_Request req = MPI_REQUEST_NULL;
+  };
+
+  int dst_, tag_;
+  size_t elem_, cap_;
+  ShmChannel *shm_;
+  std::vector<Slot> slots_;
+  size_t next_ = 0;
+  bool in_slot_ = false;
+  void *shm_payload_ = nullptr;
+};
+
+// Receiving end of a hop with `depth` receives pre-posted, so frames for
+// ticks t+1.. land while the owner is still working on tick t.
+class RxLink
+{
+public:
+  RxLink(int src, int tag, size_t elem, size_t cap, int depth, ShmChannel *shm = nullptr);
+  ~RxLink();
+  RxLink(const RxLink &) = delete;
+  RxLink &operator=(const RxLink &) = delete;
+
+  // Number of frames that have arrived and not been popped (non-blocking).
+  size_t ready();
+  // Block until at least one frame is ready.
+  void wait();
+
+  // i-th oldest ready frame (i < ready()).
+  [[nodiscard]] const FrameHdr &hdr(size_t i = 0) const;
+  [[nodiscard]] const void *payload(size_t i = 0) const;
+  template <typename T>
+  [[nodiscard]] const T *payload(size_t i = 0) const { return static_cast<const T *>(payload(i)); }
+
+  // Done with the oldest frame: re-post its receive / free its shm slot.
+  void pop();
+
+private:
+  struct Slot
+  {
+    std::vector<unsigned char> buf;
+    MPI_Request req = MPI_REQUEST_NULL;
+    bool done = false;
+    const void *payload = nullptr;
+  };
+  void post(Slot &s);
+
+  int src_, tag_;
+  size_t elem_, cap_;
+  ShmChannel *shm_;
+  std::vector<Slot> slots_;
+  size_t head_ = 0;      // oldest outstanding slot
+  size_t ready_ = 0;     // completed frames from head_
+  size_t shm_ready_ = 0; // of those, payloads held in shm slots
+};
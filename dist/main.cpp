@@ -8,19 +8,28 @@
 #include <cstring>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <map>
+#include <string>
 
+#include "common/config.h"
 #include "common/ids.h"
+#include "common/log.h"
+#include "common/numa.h"
+#include "common/packed.h"
+#include "common/perf.h"
+#include "common/results.h"
 #include "common/schema.h"
 #include "common/timers.h"
 #include "ingest/ingest.h"
 #include "aggregate/aggregate.h"
 #include "predict/predict.h"
 #include "control/control.h"
-
-// 1s firm tick
-static constexpr uint32_t TICK_MS = 1000;
-static constexpr uint32_t BUDGET_P = 350;
-static constexpr uint32_t BUDGET_C = 150;
+#include "control/cmd_stream.h"
+#include "dist/pred_table.h"
+#include "dist/shm_channel.h"
+#include "dist/link.h"
+#include "dist/balance.h"
 
 static inline uint32_t env_u32(const char *n, uint32_t d)
 {
@@ -62,6 +71,378 @@ static void drain_bp(int &accum)
   } while (flag);
 }
 
+// A run of predictions the controller acts on: rows[k * stride], k < n.
+struct SliceView
+{
+  const Prediction *rows;
+  uint32_t n;
+  uint32_t stride;
+};
+
+// Predictor throughput report for capacity-weighted slicing: {n, elapsed_us}.
+static void send_cap_to_agg(int rAgg, uint32_t n, uint32_t elapsed_us)
+{
+  uint32_t rep[2] = {n, elapsed_us};
+  MPI_Send(rep, 2, MPI_UINT32_T, rAgg, TAG_CAP, MPI_COMM_WORLD);
+}
+static void drain_cap(SliceBalancer &bal)
+{
+  int flag = 0;
+  MPI_Status st;
+  do
+  {
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_CAP, MPI_COMM_WORLD, &flag, &st);
+    if (flag)
+    {
+      uint32_t rep[2] = {0, 0};
+      MPI_Recv(rep, 2, MPI_UINT32_T, st.MPI_SOURCE, TAG_CAP, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      bal.report(st.MPI_SOURCE - 1, rep[0], rep[1]);
+    }
+  } while (flag);
+}
+
+// True once the low-32-bit steady-ms deadline carried in a frame has passed.
+static inline bool past(uint32_t deadline_ms)
+{
+  return deadline_ms != 0 && (int32_t)((uint32_t)now_ms() - deadline_ms) > 0;
+}
+
+// Where the first ready copy of each slice of `tick` sits: at[s] = {p, i}
+// (rx[p]->hdr(i)), p = 0 when no copy has arrived. Returns the slices present.
+using FrameAt = std::pair<int, size_t>;
+static int locate_slices(std::vector<std::unique_ptr<RxLink>> &rx, int P, int64_t tick, std::vector<FrameAt> &at)
+{
+  at.assign(P, FrameAt{0, 0});
+  int have = 0;
+  for (int p = 1; p <= P; ++p)
+    for (size_t i = 0, n = rx[p]->ready(); i < n; ++i)
+    {
+      const FrameHdr &h = rx[p]->hdr(i);
+      if ((int64_t)h.tick_id == tick && !(h.flags & kFrameEnd) && h.slice < P && at[h.slice].first == 0)
+      {
+        at[h.slice] = FrameAt{p, i};
+        ++have;
+      }
+    }
+  return have;
+}
+
+// Newest tick id (> after) any predictor has delivered, or -1.
+static int64_t freshest_any(std::vector<std::unique_ptr<RxLink>> &rx, int P, int64_t after)
+{
+  int64_t best = -1;
+  for (int p = 1; p <= P; ++p)
+    for (size_t i = 0, n = rx[p]->ready(); i < n; ++i)
+      if (!(rx[p]->hdr(i).flags & kFrameEnd))
+        best = std::max<int64_t>(best, rx[p]->hdr(i).tick_id);
+  return best > after ? best : -1;
+}
+
+// Newest tick id (> after) for which every slice has a copy ready (from its
+// own predictor or a hedge), or -1.
+static int64_t freshest_complete(std::vector<std::unique_ptr<RxLink>> &rx, int P, int64_t after,
+                                 std::vector<FrameAt> &at)
+{
+  for (int64_t tick = freshest_any(rx, P, after); tick > after; --tick)
+    if (locate_slices(rx, P, tick, at) == P)
+      return tick;
+  return -1;
+}
+
+// Controller -> aggregator: re-issue slice `slice` of `tick_id` to `target`.
+static void send_reissue(int rAgg, uint32_t tick_id, int slice, int target)
+{
+  uint32_t req[3] = {tick_id, (uint32_t)slice, (uint32_t)target};
+  MPI_Send(req, 3, MPI_UINT32_T, rAgg, TAG_HEDGE, MPI_COMM_WORLD);
+}
+
+// Ask for every missing slice of `tick_id` (have[s] == 0) to be recomputed
+// by a rank that has already delivered its own slice of that tick. Returns
+// the number of requests sent.
+static int request_missing(int rAgg, uint32_t tick_id, const std::vector<uint8_t> &have)
+{
+  std::vector<int> idle;
+  for (size_t s = 0; s < have.size(); ++s)
+    if (have[s])
+      idle.push_back((int)s + 1);
+  if (idle.empty())
+    return 0;
+  int sent = 0;
+  for (size_t s = 0; s < have.size(); ++s)
+    if (!have[s])
+      send_reissue(rAgg, tick_id, (int)s, idle[sent++ % idle.size()]);
+  return sent;
+}
+
+// Hybrid MPI+OpenMP placement (DIST_PIN=1): ranks sharing a node are dealt
+// round-robin onto NUMA domains (one rank per socket when ranks == sockets);
+// ranks landing on the same domain split its cpus. Each rank pins itself and
+// one OpenMP worker per cpu, before any per-junction state is allocated.
+static void place_rank(int rank, const char *role)
+{
+  MPI_Comm node;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+  int lrank = 0, lsize = 1;
+  MPI_Comm_rank(node, &lrank);
+  MPI_Comm_size(node, &lsize);
+  MPI_Comm_free(&node);
+
+  const auto &topo = numa::topology();
+  const int D = topo.num_domains();
+  const int dom = lrank % D;
+  const int share = (lsize - dom + D - 1) / D; // ranks on this domain
+  const int slot = lrank / D;
+  const auto &all = topo.cpus_of(dom);
+  std::vector<int> mine;
+  const size_t per = std::max<size_t>(1, all.size() / std::max(1, share));
+  for (size_t i = slot * per; i < all.size() && mine.size() < per; ++i)
+    mine.push_back(all[i]);
+  if (mine.empty())
+    mine.push_back(all[slot % all.size()]);
+
+  numa::pin_self(mine);
+  numa::pin_omp_team(mine);
+  std::fprintf(stderr, "[PLACE] rank=%d role=%s node-rank=%d/%d domain=%d/%d cpus=%s omp=%zu\n",
+               rank, role, lrank, lsize, dom, D, numa::format_cpulist(mine).c_str(), mine.size());
+  std::fflush(stderr);
+}
+
+// Chunked ticks (TWIN_CHUNK=<junctions>): each hop moves blocks of junctions
+// as soon as they are produced instead of whole ticks, so the aggregator maps
+// block b while ingest generates block b+1 and predictions reach the
+// controller block by block. Block b of a tick goes to predictor b % P + 1;
+// after the last block every predictor gets an empty kFrameTickEnd frame,
+// which it forwards, and the controller closes the tick once all P arrive.
+struct StreamPlan
+{
+  uint32_t J, chunk, blocks, ticks, tick_ms, budget_p;
+  int P, depth;
+  size_t block_samples; // lanes in the largest block (Ing->Agg frame capacity)
+  int ia_frames;        // Ing->Agg frames in flight
+  int ap_frames;        // frames in flight on each Agg->Pred and Pred->Ctrl hop
+
+  StreamPlan(const LaneIndex &lanes, uint32_t chunk_, uint32_t ticks_, uint32_t tick_ms_, uint32_t budget_p_,
+             int P_, int depth_)
+      : J(lanes.junctions()), chunk(chunk_), blocks((J + chunk_ - 1) / chunk_), ticks(ticks_), tick_ms(tick_ms_),
+        budget_p(budget_p_), P(P_), depth(depth_), block_samples(0)
+  {
+    for (uint32_t j0 = 0; j0 < J; j0 += chunk)
+      block_samples = std::max<size_t>(block_samples, lanes.begin(std::min(J, j0 + chunk)) - lanes.begin(j0));
+    ia_frames = (int)blocks * depth;
+    ap_frames = ((int)(blocks + P - 1) / P + 1) * depth; // data blocks + tick end
+  }
+  [[nodiscard]] uint32_t end(uint32_t j0) const { return std::min(J, j0 + chunk); }
+};
+
+static void stream_ingest(const StreamPlan &sp, Ingestor &ing, int rAgg, ShmChannel *shm)
+{
+  TxLink tx(rAgg, TAG_FEAT, sizeof(SensorSample), sp.block_samples, sp.ia_frames, shm);
+  uint64_t base = now_ms(), first = base + 200;
+  sleep_until_ms(first);
+  for (uint32_t t = 0; t < sp.ticks; ++t)
+  {
+    uint64_t tick_start = first + t * sp.tick_ms;
+    const uint32_t deadline = (uint32_t)(tick_start + (uint64_t)sp.depth * sp.tick_ms);
+    for (uint32_t j0 = 0; j0 < sp.J; j0 += sp.chunk)
+    {
+      const uint32_t j1 = sp.end(j0);
+      uint32_t cnt = 0;
+      {
+        perf::Region r("ingest");
+        cnt = (uint32_t)ing.generate(t, j0, j1, tx.acquire<SensorSample>());
+      }
+      tx.send(t, cnt, deadline, 0, j1 == sp.J ? kFrameTickEnd : 0);
+    }
+    sleep_until_ms(tick_start + sp.tick_ms);
+  }
+  tx.flush();
+}
+
+static void stream_aggregate(const StreamPlan &sp, Aggregator &agg, int rIng, ShmChannel *chIA,
+                             std::vector<std::unique_ptr<ShmChannel>> &chAP)
+{
+  const int P = sp.P;
+  RxLink rx(rIng, TAG_FEAT, sizeof(SensorSample), sp.block_samples, sp.ia_frames, chIA);
+  std::vector<std::unique_ptr<TxLink>> tx(P + 1);
+  for (int p = 1; p <= P; ++p)
+    tx[p] = std::make_unique<TxLink>(p, TAG_FEAT, sizeof(Features), sp.chunk, sp.ap_frames, chAP[p].get());
+
+  int stride = 1;
+  uint32_t block = 0; // block index within the current tick
+  for (bool last_tick = false; !last_tick;)
+  {
+    rx.wait();
+    const FrameHdr h = rx.hdr();
+    const SensorSample *s = rx.payload<SensorSample>();
+    const uint32_t j0 = h.n ? s[0].junction : 0, j1 = h.n ? s[h.n - 1].junction + 1 : 0;
+    if (block == 0)
+    {
+      int bp = 0;
+      drain_bp(bp);
+      stride = stride_for_level(bp);
+      agg.begin_tick();
+    }
+
+    // Map straight into the predictor's frame, then keep every stride-th
+    // junction in place under backpressure.
+    TxLink &out = *tx[block % P + 1];
+    Features *f = out.acquire<Features>();
+    {
+      perf::Region r("agg");
+      agg.map_block(s, j0, j1, f);
+    }
+    uint32_t n = j1 - j0;
+    if (stride > 1)
+    {
+      n = 0;
+      for (uint32_t j = j0; j < j1; ++j)
+        if (j % stride == 0)
+          f[n++] = f[j - j0];
+    }
+    out.send(h.tick_id, n, h.deadline_ms);
+    rx.pop();
+    ++block;
+
+    if (h.flags & kFrameTickEnd)
+    {
+      agg.end_tick();
+      for (int p = 1; p <= P; ++p)
+      {
+        tx[p]->acquire();
+        tx[p]->send(h.tick_id, 0, h.deadline_ms, 0, kFrameTickEnd);
+      }
+      block = 0;
+      last_tick = h.tick_id + 1 >= sp.ticks;
+    }
+  }
+  for (int p = 1; p <= P; ++p)
+  {
+    tx[p]->acquire();
+    tx[p]->send(sp.ticks, 0, 0, 0, kFrameEnd);
+  }
+  for (int p = 1; p <= P; ++p)
+    tx[p]->flush();
+}
+
+static void stream_predict(const StreamPlan &sp, Predictor &pred, ShmChannel *chAP, ShmChannel *chPC)
+{
+  RxLink rx(sp.P + 1, TAG_FEAT, sizeof(Features), sp.chunk, sp.ap_frames, chAP);
+  TxLink tx(0, TAG_PRED, sizeof(Prediction), sp.chunk, sp.ap_frames, chPC);
+  std::vector<Prediction> preds;
+  uint64_t busy_us = 0; // predict time spent on the current tick
+  for (;;)
+  {
+    rx.wait();
+    const FrameHdr h = rx.hdr();
+    if (h.flags & kFrameEnd)
+    {
+      rx.pop();
+      break;
+    }
+    Prediction *out = tx.acquire<Prediction>();
+    if (h.n)
+    {
+      const uint64_t us0 = now_us();
+      {
+        perf::Region r("pred");
+        pred.predict_batch(rx.payload<Features>(), h.n, preds);
+      }
+      busy_us += now_us() - us0;
+      std::copy(preds.begin(), preds.end(), out);
+    }
+    rx.pop();
+    tx.send(h.tick_id, h.n, h.deadline_ms, 0, h.flags & kFrameTickEnd);
+    if (h.flags & kFrameTickEnd)
+    {
+      if (busy_us > (uint64_t)sp.budget_p * 1000)
+        send_bp_to_agg(sp.P + 1, 1);
+      busy_us = 0;
+    }
+  }
+  tx.acquire();
+  tx.send(sp.ticks, 0, 0, 0, kFrameEnd);
+  tx.flush();
+}
+
+static void stream_control(const StreamPlan &sp, Controller &ctrl, std::vector<std::unique_ptr<ShmChannel>> &chPC,
+                           RunResults &results, CmdStream *out)
+{
+  const int P = sp.P;
+  std::vector<std::unique_ptr<RxLink>> rx(P + 1);
+  for (int p = 1; p <= P; ++p)
+    rx[p] = std::make_unique<RxLink>(p, TAG_PRED, sizeof(Prediction), sp.chunk, sp.ap_frames, chPC[p].get());
+
+  // Ticks still open; predictors can be a block or a tick apart.
+  struct Open
+  {
+    int ended = 0; // predictors that closed the tick
+    uint32_t blocks = 0;
+    size_t npreds = 0;
+    uint32_t top0 = 9999u;
+    float best = -1.f;
+    std::vector<PhaseCmd> cmds; // the tick's commands, block by block
+  };
+  std::map<uint32_t, Open> open;
+  std::vector<uint8_t> ended(P + 1, 0);
+  uint32_t closed = 0, misses = 0;
+  for (int done = 0; done < P;)
+  {
+    bool any = false;
+    for (int p = 1; p <= P; ++p)
+      while (!ended[p] && rx[p]->ready() > 0)
+      {
+        any = true;
+        const FrameHdr &h = rx[p]->hdr();
+        if (h.flags & kFrameEnd)
+        {
+          ended[p] = 1;
+          ++done;
+          rx[p]->pop();
+          break;
+        }
+        Open &o = open[h.tick_id];
+        if (h.n)
+        {
+          // Commands for this block are decided now, not at the end of the tick.
+          const Prediction *rows = rx[p]->payload<Prediction>();
+          {
+            perf::Region r("ctrl");
+            ctrl.decide_append(rows, h.n, 1, o.cmds, true);
+          }
+          for (uint32_t k = 0; k < h.n; ++k)
+            if (rows[k].congestion_60s > o.best)
+            {
+              o.best = rows[k].congestion_60s;
+              o.top0 = rows[k].junction;
+            }
+          o.npreds += h.n;
+          ++o.blocks;
+        }
+        if ((h.flags & kFrameTickEnd) && ++o.ended == P)
+        {
+          // Latency from the tick's start at ingest (deadline - depth ticks,
+          // same node steady clock) to its last block decided.
+          const uint32_t start = h.deadline_ms - (uint32_t)sp.depth * sp.tick_ms;
+          const long long lat = (long long)(int32_t)((uint32_t)now_ms() - start);
+          const bool late = lat > (long long)sp.tick_ms;
+          misses += late;
+          ++closed;
+          results.tick((double)lat, o.npreds, late);
+          std::printf("[CTRL] tick %2u | slices %d/%d | preds=%zu | top0=%u | miss-ratio=%.2f | lat=%lldms | blocks=%u\n",
+                      h.tick_id, P, P, o.npreds, o.top0, (double)misses / closed, lat, o.blocks);
+          std::fflush(stdout);
+          send_bp_to_agg(P + 1, late ? 1 : 0);
+          if (out)
+            out->publish(h.tick_id, h.tick_id, o.cmds);
+          open.erase(h.tick_id);
+        }
+        rx[p]->pop();
+      }
+    if (!any)
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
 int main(int argc, char **argv)
 {
   MPI_Init(&argc, &argv);
@@ -77,113 +458,500 @@ int main(int argc, char **argv)
   const int rCtrl = 0, rAgg = P + 1, rIng = P + 2;
   (void)rCtrl; // silence unused warning
 
-  const uint32_t J = env_u32("JUNCTIONS", 20000);
-  IngestConfig icfg{.junctions = J, .lanes_per = 3, .tick_ms = TICK_MS};
-  AggConfig acfg{.junctions = J, .lanes_per = 3};
-  PredConfig pcfg{.prefer_opencl = true};
+  // Scenario from --options / environment (common/config.h), parsed the same
+  // way on every rank; the defaults are the original fixed run (20000
+  // junctions, 40 ticks, OpenCL predictors).
+  TwinConfig cfg;
+  cfg.variant = "dist";
+  cfg.ticks = 40;
+  cfg.opencl = true;
+  if (std::string err; !cfg.parse(argc, argv, err))
+  {
+    if (rank == 0)
+    {
+      if (!err.empty())
+        std::fprintf(stderr, "dist_twin: %s\n", err.c_str());
+      TwinConfig::usage(stderr, argv[0]);
+    }
+    MPI_Finalize();
+    return err.empty() ? 0 : 2;
+  }
+  cfg.apply_threads();
+  if (rank == 0)
+    cfg.print(stderr);
+  const uint32_t J = cfg.junctions;
+  // 1s firm tick by default; TICK_MS may go below the sum of stage latencies
+  // once DIST_PIPE keeps several ticks in flight.
+  const uint32_t TICK_MS = cfg.tick_ms;
+  const uint32_t TICKS = cfg.ticks;
+  const uint32_t BUDGET_P = cfg.budget_pred_ms, BUDGET_C = cfg.budget_ctrl_ms;
+  // DIST_PIPE=K: every hop keeps up to K ticks in flight (pre-posted receives,
+  // non-blocking sends); K=1 is the classic one-tick-at-a-time pipeline.
+  const int depth = (int)std::min<uint32_t>(env_u32("DIST_PIPE", 1), 16);
+  // TWIN_CHUNK=<junctions>: chunked ticks (StreamPlan above); whole-tick
+  // slicing, hedging and the RMA table do not apply and stay off.
+  const uint32_t chunk = env_u32("TWIN_CHUNK", 0);
+  const bool stream = chunk > 0 && chunk < J;
+  // DIST_BALANCE=1: size predictor slices by measured throughput instead of
+  // an even split (see dist/balance.h).
+  const bool balance = !stream && env_u32("DIST_BALANCE", 0) != 0;
+  // DIST_ANYTIME=1: predictors work hottest junctions first and, at the
+  // predictor budget, send what they have as a partial slice (kFramePartial);
+  // the controller acts on it like a full one. Partial slices are not
+  // arithmetic junction runs, so packing and the RMA table stay off.
+  const bool anytime = !stream && env_u32("DIST_ANYTIME", 0) != 0;
+  // DIST_RMA=1: predictors MPI_Put straight into a junction-indexed table on
+  // the controller instead of sending their slices as messages.
+  const bool rma = !stream && !anytime && env_u32("DIST_RMA", 0) != 0;
+  // DIST_HEDGE=H: the H hottest slices (most reduce_topN hotspots) also go to
+  // a second predictor, and slices still missing DIST_HEDGE_AT percent into
+  // the controller's tick are re-issued to a rank that has already delivered.
+  // The controller keeps the first copy of each slice and derates only the
+  // junctions of slices that never arrived. Off with DIST_RMA: two copies of
+  // a slice would Put into the same table rows at once.
+  const int hedge = (P > 1 && !stream && !rma) ? (int)std::min<uint32_t>(env_u32("DIST_HEDGE", 0), (uint32_t)P) : 0;
+  const uint32_t hedge_at_ms = TICK_MS * std::min<uint32_t>(env_u32("DIST_HEDGE_AT", 60), 100) / 100;
+  // Hedged hops carry up to three frames per tick per predictor (its own
+  // slice, a hot-slice copy and a re-issue); give them room for all three.
+  const int slice_depth = hedge ? 3 * depth : depth;
+  // DIST_PACK=fp16|int8: Agg->Pred slices carry only the model inputs,
+  // quantized per feature, and Pred->Ctrl slices 16-bit fixed-point
+  // congestion (common/packed.h). Frames on these hops then count bytes.
+  const packed::Format pack = (stream || anytime) ? packed::Format::None : packed::from_env("DIST_PACK");
+  const bool packing = pack != packed::Format::None;
+  const size_t ap_elem = packing ? 1 : sizeof(Features), ap_cap = packing ? packed::feature_bytes(pack, J) : J;
+  const size_t pc_elem = packing ? 1 : sizeof(Prediction), pc_cap = packing ? packed::pred_bytes(J) : J;
+  // LANES=<lo>-<hi> / LANES_FILE=<path>: per-junction lane counts (default 3),
+  // derived identically on every rank; the Ing->Agg frame carries sum(lanes).
+  auto lanes = cfg.lane_index();
+  IngestConfig icfg{.junctions = J, .lanes_per = 3, .tick_ms = TICK_MS, .lanes = lanes};
+  AggConfig acfg{.junctions = J, .lanes_per = 3, .lanes = lanes, .window = {cfg.win_short, cfg.win_long}};
+  PredConfig pcfg{.prefer_opencl = cfg.opencl};
   CtrlConfig ccfg{};
 
   if (rank == 0)
   {
     std::fprintf(stderr, "[BOOT] world=%d, predictors=%d | Ctrl=0 Agg=%d Ing=%d\n", world, P, rAgg, rIng);
+    if (depth > 1)
+      std::fprintf(stderr, "[BOOT] pipeline depth=%d tick=%ums\n", depth, TICK_MS);
+    if (lanes->samples() != (size_t)J * 3)
+      std::fprintf(stderr, "[BOOT] lanes=%zu (%.2f/junction, max %u)\n", lanes->samples(),
+                   (double)lanes->samples() / J, lanes->max_lanes());
+    if (hedge)
+      std::fprintf(stderr, "[BOOT] hedge hot-slices=%d reissue-at=%ums\n", hedge, hedge_at_ms);
+    if (stream)
+      std::fprintf(stderr, "[BOOT] chunk=%u junctions (%u blocks/tick)%s\n", chunk, (J + chunk - 1) / chunk,
+                   (env_u32("DIST_RMA", 0) || env_u32("DIST_HEDGE", 0) || env_u32("DIST_BALANCE", 0) ||
+                    env_u32("DIST_ANYTIME", 0) || packed::from_env("DIST_PACK") != packed::Format::None)
+                       ? ", DIST_RMA/DIST_HEDGE/DIST_BALANCE/DIST_PACK/DIST_ANYTIME off"
+                       : "");
+    if (anytime)
+      std::fprintf(stderr, "[BOOT] anytime block=%zu budget=%ums%s\n", Predictor::kAnytimeBlock, BUDGET_P,
+                   (env_u32("DIST_RMA", 0) || packed::from_env("DIST_PACK") != packed::Format::None)
+                       ? ", DIST_RMA/DIST_PACK off"
+                       : "");
+    if (packing)
+      std::fprintf(stderr, "[BOOT] pack=%s slice=%zuB (fp32 %zuB) preds=%zuB (fp32 %zuB)\n", packed::name(pack),
+                   packed::feature_bytes(pack, J), sizeof(Features) * J, packed::pred_bytes(J), sizeof(Prediction) * J);
     std::fflush(stderr);
   }
 
-  const uint32_t TICKS = 40;
+  const StreamPlan plan(*lanes, stream ? chunk : J, TICKS, TICK_MS, BUDGET_P, P, depth);
+  // Written by the controller, the rank that sees every tick's outcome.
+  RunResults results(cfg);
+  results.set("ranks", world);
+  results.set("predictors", P);
+  results.set("depth", depth);
+  results.set("chunk", stream ? chunk : J);
+  results.set("anytime", anytime);
+
+  if (env_u32("DIST_PIN", 0) != 0)
+    place_rank(rank, rank == 0 ? "ctrl" : rank == rAgg ? "agg" : rank == rIng ? "ing" : "pred");
+
+  // DIST_RMA table (see `rma` above). Collective.
+  std::unique_ptr<PredTable> table;
+  if (rma)
+    table = std::make_unique<PredTable>(MPI_COMM_WORLD, 0, J, P, depth + 1);
+  if (rank == 0 && rma)
+  {
+    std::fprintf(stderr, "[BOOT] gather=rma table=%u junctions x %d planes%s\n", J, depth + 1,
+                 env_u32("DIST_HEDGE", 0) ? ", DIST_HEDGE off" : "");
+    std::fflush(stderr);
+  }
 
-  if (rank == rIng)
+  // DIST_SHM=1: co-located ranks exchange tick payloads through shared-memory
+  // slots (dist/shm_channel.*); the frame message shrinks to a header-only
+  // notification and remote pairs keep full frames. Collective over each node.
+  const bool shm = env_u32("DIST_SHM", 0) != 0;
+  MPI_Comm node = MPI_COMM_NULL;
+  std::unique_ptr<ShmChannel> chIA;                     // Ing -> Agg
+  std::vector<std::unique_ptr<ShmChannel>> chAP(P + 1); // Agg -> Pred p (index = rank)
+  std::vector<std::unique_ptr<ShmChannel>> chPC(P + 1); // Pred p -> Ctrl
+  if (shm)
+  {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    // Chunked ticks hold more, smaller frames in flight per hop.
+    const size_t ia_n = stream ? plan.block_samples : lanes->samples(), ap_n = stream ? chunk : J;
+    const size_t ap_bytes = packing ? ap_cap : sizeof(Features) * ap_n, pc_bytes = packing ? pc_cap : sizeof(Prediction) * ap_n;
+    const int ia_slots = (stream ? plan.ia_frames : depth) + 1, ap_slots = (stream ? plan.ap_frames : slice_depth) + 1;
+    chIA = std::make_unique<ShmChannel>(node, rIng, rAgg, sizeof(SensorSample) * ia_n, ia_slots);
+    for (int p = 1; p <= P; ++p)
+    {
+      chAP[p] = std::make_unique<ShmChannel>(node, rAgg, p, ap_bytes, ap_slots);
+      chPC[p] = std::make_unique<ShmChannel>(node, p, 0, pc_bytes, ap_slots);
+    }
+    if (rank == 0)
+    {
+      int local = chIA->local();
+      for (int p = 1; p <= P; ++p)
+        local += chAP[p]->local() + chPC[p]->local();
+      std::fprintf(stderr, "[BOOT] transport=shm local-hops=%d/%d\n", local, 1 + 2 * P);
+      std::fflush(stderr);
+    }
+  }
+
+  if (stream)
+  {
+    if (rank == rIng)
+    {
+      Ingestor ing(icfg);
+      stream_ingest(plan, ing, rAgg, chIA.get());
+    }
+    else if (rank == rAgg)
+    {
+      acfg.graph = JunctionGraph::from_env(J);
+      Aggregator agg(acfg);
+      stream_aggregate(plan, agg, rIng, chIA.get(), chAP);
+    }
+    else if (rank >= 1 && rank <= P)
+    {
+      Predictor pred(pcfg);
+      stream_predict(plan, pred, chAP[rank].get(), chPC[rank].get());
+    }
+    else if (rank == 0)
+    {
+      Controller ctrl(ccfg);
+      auto out = CmdStream::from_env(J);
+      stream_control(plan, ctrl, chPC, results, out.get());
+    }
+  }
+  else if (rank == rIng)
   {
     Ingestor ing(icfg);
-    std::vector<SensorSample> samples;
+    TxLink tx(rAgg, TAG_FEAT, sizeof(SensorSample), ing.samples_per_tick(), depth, chIA.get());
     uint64_t base = now_ms(), first = base + 200;
     sleep_until_ms(first);
     for (uint32_t t = 0; t < TICKS; ++t)
     {
       uint64_t tick_start = first + t * TICK_MS;
-      ing.generate(t, samples);
-      int cnt = (int)samples.size();
-      MPI_Send(&t, 1, MPI_UNSIGNED, rAgg, TAG_FEAT, MPI_COMM_WORLD);
-      MPI_Send(&cnt, 1, MPI_INT, rAgg, TAG_FEAT, MPI_COMM_WORLD);
-      if (cnt > 0)
-        MPI_Send(samples.data(), cnt * (int)sizeof(SensorSample), MPI_BYTE, rAgg, TAG_FEAT, MPI_COMM_WORLD);
+      // Generate straight into the outgoing frame (or the aggregator's slot).
+      uint32_t cnt = 0;
+      {
+        perf::Region r("ingest");
+        cnt = (uint32_t)ing.generate(t, tx.acquire<SensorSample>());
+      }
+      tx.send(t, cnt, (uint32_t)(tick_start + (uint64_t)depth * TICK_MS));
       sleep_until_ms(tick_start + TICK_MS);
     }
+    tx.flush();
   }
   else if (rank == rAgg)
   {
+    // GRAPH_FILE=<path>: only the aggregator needs the junction graph; the
+    // upstream pressure travels to predictors inside the feature slices.
+    acfg.graph = JunctionGraph::from_env(J);
     Aggregator agg(acfg);
-    std::vector<SensorSample> samples;
-    std::vector<Features> feats, thin;
-    for (uint32_t t = 0; t < TICKS; ++t)
+    RxLink rx(rIng, TAG_FEAT, sizeof(SensorSample), lanes->samples(), depth, chIA.get());
+    std::vector<std::unique_ptr<TxLink>> tx(P + 1);
+    for (int p = 1; p <= P; ++p)
+      tx[p] = std::make_unique<TxLink>(p, TAG_FEAT, ap_elem, ap_cap, slice_depth, chAP[p].get());
+    SliceBalancer bal(P);
+    std::vector<int> bounds(P + 1, 0);
+    // Mapped ticks kept for re-issue requests; one is enough without hedging.
+    struct Kept
+    {
+      int64_t tick = -1;
+      uint32_t deadline_ms = 0;
+      int stride = 1;
+      std::vector<int> bounds;
+      std::vector<Features> feats;
+    };
+    std::vector<Kept> kept(hedge ? depth + 1 : 1);
+    std::vector<uint32_t> hot;
+    std::vector<std::pair<int, int>> heat(P); // {hotspots, slice}
+    // Packed slices: a CPU predictor compares the packed path with fp32 on
+    // the full tick every 10 ticks ([PACK] lines).
+    std::unique_ptr<Predictor> checker;
+    if (packing)
+      checker = std::make_unique<Predictor>(PredConfig{.prefer_opencl = false});
+
+    // Slice `s` of a kept tick, thinned rows written straight into the frame.
+    auto send_slice = [&](const Kept &k, int s, int dst, uint16_t flags)
+    {
+      perf::Region r("agg.send");
+      const int begin = k.bounds[s], n = k.bounds[s + 1] - begin;
+      if (packing)
+      {
+        const size_t bytes = packed::pack_features(pack, k.feats.data() + (size_t)begin * k.stride, n, k.stride,
+                                                   tx[dst]->acquire());
+        tx[dst]->send((uint32_t)k.tick, (uint32_t)bytes, k.deadline_ms, (uint16_t)s, flags);
+        return;
+      }
+      Features *out = tx[dst]->acquire<Features>();
+      for (int i = 0; i < n; ++i)
+        out[i] = k.feats[(size_t)(begin + i) * k.stride];
+      tx[dst]->send((uint32_t)k.tick, (uint32_t)n, k.deadline_ms, (uint16_t)s, flags);
+    };
+    auto serve_reissues = [&]()
+    {
+      int flag = 0;
+      MPI_Status st;
+      for (;;)
+      {
+        MPI_Iprobe(0, TAG_HEDGE, MPI_COMM_WORLD, &flag, &st);
+        if (!flag)
+          break;
+        uint32_t req[3] = {0, 0, 0};
+        MPI_Recv(req, 3, MPI_UINT32_T, 0, TAG_HEDGE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        const Kept &k = kept[req[0] % kept.size()];
+        if (k.tick == (int64_t)req[0] && (int)req[1] < P && req[2] >= 1 && (int)req[2] <= P)
+          send_slice(k, (int)req[1], (int)req[2], kFrameHedge);
+      }
+    };
+
+    for (uint32_t mapped = 0; mapped < TICKS; ++mapped)
     {
       int bp = 0;
       drain_bp(bp);
       int stride = stride_for_level(bp);
+      if (balance)
+        drain_cap(bal);
 
-      MPI_Status st;
-      uint32_t tick_id;
-      int cnt = 0;
-      MPI_Recv(&tick_id, 1, MPI_UNSIGNED, rIng, TAG_FEAT, MPI_COMM_WORLD, &st);
-      MPI_Recv(&cnt, 1, MPI_INT, rIng, TAG_FEAT, MPI_COMM_WORLD, &st);
-      samples.resize(std::max(cnt, 0));
-      if (cnt > 0)
-        MPI_Recv(samples.data(), cnt * (int)sizeof(SensorSample), MPI_BYTE, rIng, TAG_FEAT, MPI_COMM_WORLD, &st);
-
-      agg.map_features(samples, feats);
-      thin.clear();
-      thin.reserve((feats.size() + stride - 1) / stride);
-      for (size_t i = 0; i < feats.size(); i += stride)
-        thin.push_back(feats[i]);
-
-      int per = (P > 0) ? (int)thin.size() / P : 0, cursor = 0;
+      // Every tick is mapped in order (EWMA state); popping right after the
+      // map lets tick t+1 land while tick t is still being scattered.
+      if (hedge)
+        while (rx.ready() == 0)
+        {
+          serve_reissues();
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+      else
+        rx.wait();
+      const FrameHdr h = rx.hdr();
+      const uint32_t tick_id = h.tick_id;
+      Kept &cur = kept[tick_id % kept.size()];
+      std::vector<Features> &feats = cur.feats;
+      {
+        perf::Region r("agg");
+        agg.map_features(rx.payload<SensorSample>(), h.n, feats);
+      }
+      rx.pop();
+      cur.tick = tick_id;
+      cur.deadline_ms = h.deadline_ms;
+      cur.stride = stride;
+
+      // Slices are cut over the thinned index space (every stride-th junction)
+      // and written straight into each predictor's outgoing frame.
+      const int nthin = (int)((feats.size() + stride - 1) / stride);
+      if (balance)
+      {
+        if (bal.cut(nthin, bounds))
+        {
+          std::fprintf(stderr, "[BAL] tick %u | slices", tick_id);
+          for (int p = 0; p < P; ++p)
+            std::fprintf(stderr, " %d:%d(%.0f/ms)", p + 1, bounds[p + 1] - bounds[p], bal.capacity(p));
+          std::fprintf(stderr, "\n");
+          std::fflush(stderr);
+        }
+      }
+      else
+      {
+        int per = (P > 0) ? nthin / P : 0;
+        for (int p = 0; p < P; ++p)
+          bounds[p] = p * per;
+        bounds[P] = nthin; // remainder goes to the last predictor
+      }
+      cur.bounds = bounds;
       for (int p = 0; p < P; ++p)
+        send_slice(cur, p, p + 1, 0);
+      if (checker && tick_id % 10 == 0)
       {
-        int begin = cursor, end = (p == P - 1) ? (int)thin.size() : (cursor + per);
-        int n = end - begin;
-        MPI_Send(&tick_id, 1, MPI_UNSIGNED, p + 1, TAG_FEAT, MPI_COMM_WORLD);
-        MPI_Send(&n, 1, MPI_INT, p + 1, TAG_FEAT, MPI_COMM_WORLD);
-        if (n > 0)
-          MPI_Send(thin.data() + begin, n * (int)sizeof(Features), MPI_BYTE, p + 1, TAG_FEAT, MPI_COMM_WORLD);
-        cursor = end;
+        const PackCheck c = checker->check_packed(pack, feats.data(), feats.size());
+        std::fprintf(stderr, "[PACK] tick %u | %s %.1fB/junction (fp32 %zuB) | err max=%.2e mean=%.2e | top0 fp32=%u %s=%u\n",
+                     tick_id, packed::name(pack), (double)packed::feature_bytes(pack, c.rows) / c.rows,
+                     sizeof(Features), c.max_err, c.mean_err, c.top0_fp32, packed::name(pack), c.top0_packed);
+        std::fflush(stderr);
+      }
+
+      if (hedge)
+      {
+        // Rank slices by how many of this tick's hotspots they carry and send
+        // the hottest ones to the next predictor as well.
+        agg.reduce_topN(feats, std::max(1, nthin / 20), hot);
+        for (int p = 0; p < P; ++p)
+          heat[p] = {0, p};
+        for (uint32_t j : hot)
+          if (j % stride == 0)
+          {
+            const int idx = j / stride;
+            const int s = (int)(std::upper_bound(bounds.begin(), bounds.end(), idx) - bounds.begin()) - 1;
+            if (s >= 0 && s < P)
+              heat[s].first++;
+          }
+        std::partial_sort(heat.begin(), heat.begin() + hedge, heat.end(),
+                          [](const auto &a, const auto &b)
+                          { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+        for (int i = 0; i < hedge; ++i)
+          send_slice(cur, heat[i].second, (heat[i].second + 1) % P + 1, kFrameHedge);
+        serve_reissues();
       }
     }
+    // End of stream: predictors stop at this marker rather than at a tick id,
+    // since hedges and re-issues make the frame count per tick variable.
+    for (int p = 1; p <= P; ++p)
+    {
+      tx[p]->acquire();
+      tx[p]->send(TICKS, 0, 0, 0, kFrameEnd);
+    }
+    for (int p = 1; p <= P; ++p)
+      tx[p]->flush();
   }
   else if (rank >= 1 && rank <= P)
   {
     Predictor pred(pcfg);
-    std::vector<Features> feats;
+    RxLink rx(P + 1, TAG_FEAT, ap_elem, ap_cap, slice_depth, chAP[rank].get());
+    std::unique_ptr<TxLink> tx;
+    if (!table)
+      tx = std::make_unique<TxLink>(0, TAG_PRED, pc_elem, pc_cap, slice_depth, chPC[rank].get());
     std::vector<Prediction> preds;
-    for (uint32_t t = 0; t < TICKS; ++t)
+    std::vector<unsigned char> packed_preds(table && packing ? pc_cap : 0); // RMA: expanded before the Put
+    for (;;)
     {
-      MPI_Status st;
-      uint32_t tick_id;
-      int n = 0;
-      MPI_Recv(&tick_id, 1, MPI_UNSIGNED, P + 1, TAG_FEAT, MPI_COMM_WORLD, &st);
-      MPI_Recv(&n, 1, MPI_INT, P + 1, TAG_FEAT, MPI_COMM_WORLD, &st);
-      feats.resize(std::max(n, 0));
-      if (n > 0)
-        MPI_Recv(feats.data(), n * (int)sizeof(Features), MPI_BYTE, P + 1, TAG_FEAT, MPI_COMM_WORLD, &st);
+      rx.wait();
+      const FrameHdr h = rx.hdr();
+      if (h.flags & kFrameEnd)
+      {
+        rx.pop();
+        break;
+      }
+      if (depth > 1)
+      {
+        // Pipelined: the freshest tick wins. Drop frames that a newer tick has
+        // already overtaken, or whose deadline passed while they were queued.
+        bool overtaken = false;
+        for (size_t i = 1, n = rx.ready(); i < n && !overtaken; ++i)
+          overtaken = !(rx.hdr(i).flags & kFrameEnd) && rx.hdr(i).tick_id > h.tick_id;
+        if (overtaken || past(h.deadline_ms))
+        {
+          rx.pop();
+          continue;
+        }
+      }
+      const uint32_t tick_id = h.tick_id;
 
       Deadline dl{.start_ms = now_ms(), .budget_ms = BUDGET_P};
-      pred.predict_batch(feats, preds);
-      if (dl.elapsed() > BUDGET_P)
+      const uint64_t us0 = now_us();
+      uint32_t rows = h.n;
+      if (packing)
+      {
+        // Inference straight from the packed slice into the outgoing frame.
+        rows = rx.payload<packed::FeatureHdr>()->rows;
+        void *dst = table ? packed_preds.data() : tx->acquire();
+        size_t bytes = 0;
+        {
+          perf::Region r("pred");
+          bytes = pred.predict_packed(rx.payload(), dst);
+        }
+        rx.pop();
+        if (balance)
+          send_cap_to_agg(P + 1, rows, (uint32_t)(now_us() - us0));
+        if (dl.elapsed() > BUDGET_P)
+          send_bp_to_agg(P + 1, 1);
+        if (table)
+        {
+          preds.resize(rows);
+          packed::unpack_predictions(dst, preds.data());
+          table->put_slice(h.slice, tick_id, preds);
+        }
+        else
+          tx->send(tick_id, (uint32_t)bytes, h.deadline_ms, h.slice, h.flags & kFrameHedge);
+        continue;
+      }
+      uint16_t partial = 0;
+      {
+        perf::Region r("pred");
+        if (anytime)
+        {
+          rows = (uint32_t)pred.predict_batch(rx.payload<Features>(), h.n, dl, preds);
+          partial = rows < h.n ? kFramePartial : 0;
+        }
+        else
+          pred.predict_batch(rx.payload<Features>(), h.n, preds);
+      }
+      rx.pop();
+      if (balance)
+        send_cap_to_agg(P + 1, rows, (uint32_t)(now_us() - us0));
+      if (partial || dl.elapsed() > BUDGET_P)
       {
         int level = 1;
         send_bp_to_agg(P + 1, level);
       }
 
-      int outn = (int)preds.size();
-      MPI_Send(&tick_id, 1, MPI_UNSIGNED, 0, TAG_PRED, MPI_COMM_WORLD);
-      MPI_Send(&outn, 1, MPI_INT, 0, TAG_PRED, MPI_COMM_WORLD);
-      if (outn > 0)
-        MPI_Send(preds.data(), outn * (int)sizeof(Prediction), MPI_BYTE, 0, TAG_PRED, MPI_COMM_WORLD);
+      if (table)
+      {
+        table->put_slice(h.slice, tick_id, preds);
+        continue;
+      }
+
+      Prediction *out = tx->acquire<Prediction>();
+      std::copy(preds.begin(), preds.end(), out);
+      tx->send(tick_id, (uint32_t)preds.size(), h.deadline_ms, h.slice, (h.flags & kFrameHedge) | partial);
+    }
+    if (tx)
+    {
+      tx->acquire();
+      tx->send(TICKS, 0, 0, 0, kFrameEnd);
+      tx->flush();
     }
   }
   else if (rank == 0)
   {
     Controller ctrl(ccfg);
+    // TWIN_CMDS=<path>: every tick's commands to a mapped ring file, written
+    // by the stream's own thread after the hand-off below.
+    auto out = CmdStream::from_env(J);
     uint64_t base = now_ms(), first = base + 300;
     uint32_t misses = 0;
+    std::vector<std::unique_ptr<RxLink>> rx(P + 1);
+    if (!table)
+      for (int p = 1; p <= P; ++p)
+        rx[p] = std::make_unique<RxLink>(p, TAG_PRED, pc_elem, pc_cap, slice_depth, chPC[p].get());
+    // Packed prediction slices are expanded here before deciding.
+    std::vector<std::vector<Prediction>> unpacked(packing ? P : 0);
+    // Per-slice views the controller decides over, wherever the rows live
+    // (received frame, shared-memory slot or RMA table).
+    std::vector<SliceView> views;
+    views.reserve(P);
+    std::vector<FrameAt> at;
+    std::vector<uint8_t> have(P, 0); // slice arrived for the acted-on tick
+    // Hedging: last rows seen per slice, the fallback for a slice that misses.
+    std::vector<std::vector<Prediction>> last_rows(hedge ? P : 0);
+    std::vector<PhaseCmd> cmds;
+    cmds.reserve(J);
+    int64_t decided = -1;                   // newest tick id acted on
+    std::vector<uint8_t> ended(P + 1, 0); // predictor's end-of-stream frame seen
+    auto pop_front = [&](int p)
+    {
+      ended[p] |= (rx[p]->hdr().flags & kFrameEnd) != 0;
+      rx[p]->pop();
+    };
+    // Pop frames at or behind `upto` (acted-on, duplicate and superseded).
+    auto pop_upto = [&](int64_t upto)
+    {
+      for (int p = 1; p <= P; ++p)
+        while (rx[p]->ready() > 0 && !(rx[p]->hdr().flags & kFrameEnd) && (int64_t)rx[p]->hdr().tick_id <= upto)
+          pop_front(p);
+    };
     for (uint32_t t = 0; t < TICKS; ++t)
     {
       uint64_t tick_start = first + t * TICK_MS;
@@ -191,62 +959,177 @@ int main(int argc, char **argv)
       sleep_until_ms(tick_start);
 
       uint64_t t0 = now_ms();
-      std::vector<Prediction> all;
-      all.reserve(4096);
-      int received = 0;
-      while (now_ms() < tick_end && received < P)
-      {
-        int flag = 0;
-        MPI_Status st;
-        MPI_Iprobe(MPI_ANY_SOURCE, TAG_PRED, MPI_COMM_WORLD, &flag, &st);
-        if (!flag)
+      views.clear();
+      std::fill(have.begin(), have.end(), 0);
+      int received = 0, reissued = 0, partial = 0;
+      bool asked = !hedge; // re-issue requests go out at most once per tick
+      int64_t act = -1;    // tick id acted on this round
+
+      if (table)
+      {
+        // RMA gather: rows are already in place; only slice epochs are
+        // polled. Same policy as the frame path below: the freshest tick
+        // every slice has published, else at the deadline the freshest
+        // partial tick (derated). Rows always come from that one tick.
+        while ((act = table->freshest_complete(decided)) < 0 && now_ms() < tick_end)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (act < 0)
+          act = table->freshest_any(decided);
+        received = act >= 0 ? table->gather((uint32_t)act) : 0;
+        for (int s = 0; s < P; ++s)
+          if ((have[s] = table->slice_ready(s)))
+          {
+            const SliceDesc &d = table->desc(s);
+            views.push_back(SliceView{table->row(s), d.n, d.stride});
+          }
+      }
+      else
+      {
+        // Wait for the freshest tick with every slice delivered (first copy
+        // of each wins); at the deadline fall back to the freshest partial tick.
+        while ((act = freshest_complete(rx, P, decided, at)) < 0 && now_ms() < tick_end)
         {
+          pop_upto(decided); // late copies must not hold back newer frames
+          if (!asked && now_ms() >= tick_start + hedge_at_ms)
+          {
+            asked = true;
+            if (int64_t pending = freshest_any(rx, P, decided); pending >= 0)
+            {
+              locate_slices(rx, P, pending, at);
+              for (int s = 0; s < P; ++s)
+                have[s] = at[s].first != 0;
+              reissued = request_missing(P + 1, (uint32_t)pending, have);
+            }
+          }
           std::this_thread::sleep_for(std::chrono::milliseconds(1));
-          continue;
         }
-        uint32_t tick_id;
-        int n = 0;
-        MPI_Recv(&tick_id, 1, MPI_UNSIGNED, st.MPI_SOURCE, TAG_PRED, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Recv(&n, 1, MPI_INT, st.MPI_SOURCE, TAG_PRED, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        size_t off = all.size();
-        all.resize(off + std::max(n, 0));
-        if (n > 0)
-          MPI_Recv(all.data() + off, n * (int)sizeof(Prediction), MPI_BYTE, st.MPI_SOURCE, TAG_PRED, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        received++;
+        if (act < 0)
+          act = freshest_any(rx, P, decided);
+        received = locate_slices(rx, P, act, at);
+        for (int s = 0; s < P; ++s)
+          if ((have[s] = at[s].first != 0))
+          {
+            const auto [p, i] = at[s];
+            if (packing)
+            {
+              std::vector<Prediction> &u = unpacked[s];
+              u.resize(rx[p]->payload<packed::PredHdr>(i)->rows);
+              packed::unpack_predictions(rx[p]->payload(i), u.data());
+              views.push_back(SliceView{u.data(), (uint32_t)u.size(), 1});
+            }
+            else
+            {
+              // An anytime slice cut short is still acted on at full
+              // strength; its uncovered (coolest) junctions keep their last
+              // command this tick.
+              views.push_back(SliceView{rx[p]->payload<Prediction>(i), rx[p]->hdr(i).n, 1});
+              partial += (rx[p]->hdr(i).flags & kFramePartial) != 0;
+            }
+          }
       }
       bool complete = (received == P);
       if (!complete)
         misses++;
 
       Deadline dctrl{.start_ms = now_ms(), .budget_ms = BUDGET_C};
-      std::vector<PhaseCmd> cmds;
-      ctrl.decide(all, cmds, complete);
-      (void)dctrl;
-
-      // Find the true top0 safely:
+      cmds.clear();
+      size_t npreds = 0, derated = 0;
       uint32_t top0 = 9999u;
-      if (!all.empty())
+      float best = -1.f;
+      for (const SliceView &v : views)
       {
-        auto it = std::max_element(all.begin(), all.end(),
-                                   [](const Prediction &a, const Prediction &b)
-                                   {
-                                     return a.congestion_60s < b.congestion_60s;
-                                   });
-        if (it != all.end())
-          top0 = it->junction;
+        // With hedging, completeness is per slice: delivered slices act at
+        // full strength and only the missing ones are derated below.
+        {
+          perf::Region r("ctrl");
+          ctrl.decide_append(v.rows, v.n, v.stride, cmds, complete || hedge);
+        }
+        // Find the true top0 safely:
+        for (uint32_t k = 0; k < v.n; ++k)
+          if (v.rows[k * v.stride].congestion_60s > best)
+          {
+            best = v.rows[k * v.stride].congestion_60s;
+            top0 = v.rows[k * v.stride].junction;
+          }
+        npreds += v.n;
       }
+      if (hedge)
+        for (int s = 0, vi = 0; s < P; ++s)
+        {
+          std::vector<Prediction> &keep = last_rows[s];
+          if (have[s])
+          {
+            const SliceView &v = views[vi++];
+            keep.resize(v.n);
+            for (uint32_t k = 0; k < v.n; ++k)
+              keep[k] = v.rows[k * v.stride];
+          }
+          else if (!keep.empty())
+          {
+            perf::Region r("ctrl");
+            ctrl.decide_append(keep.data(), keep.size(), 1, cmds, false);
+            derated += keep.size();
+          }
+        }
+      if (!table)
+        pop_upto(act);
+      if (act >= 0)
+        decided = act;
+      (void)dctrl;
 
       long long lat = (long long)(now_ms() - t0);
       double miss_ratio = (double)misses / (double)(t + 1);
-      std::printf("[CTRL] tick %2u | slices %d/%d | preds=%zu | top0=%u | miss-ratio=%.2f | lat=%lldms\n",
-                  t, complete ? P : received, P, all.size(), top0, miss_ratio, lat);
+      results.tick((double)lat, npreds, !complete);
+      if (out)
+        out->publish(t, act >= 0 ? (uint32_t)act : kCmdNoSource, cmds, derated > 0);
+      std::printf("[CTRL] tick %2u | slices %d/%d | preds=%zu | top0=%u | miss-ratio=%.2f | lat=%lldms",
+                  t, received, P, npreds, top0, miss_ratio, lat);
+      if (depth > 1)
+        std::printf(" | age=%lld", act >= 0 ? (long long)t - act : -1LL);
+      if (hedge)
+        std::printf(" | reissued=%d derated=%zu", reissued, derated);
+      if (anytime)
+        std::printf(" | partial=%d", partial);
+      std::printf("\n");
       std::fflush(stdout);
 
       send_bp_to_agg(P + 1, complete ? 0 : 1);
       sleep_until_ms(tick_end);
     }
+
+    // Drain every predictor up to its end-of-stream frame so no send is left
+    // pending.
+    if (!table)
+      for (int p = 1; p <= P; ++p)
+        while (!ended[p])
+        {
+          rx[p]->wait();
+          pop_front(p);
+        }
+  }
+
+  if (rank == 0)
+    results.write();
+
+  // Peak memory per rank, normalised per junction (scripts/scale_check.sh),
+  // and with TWIN_PERF=1 this rank's stage counters.
+  {
+    const char *role = rank == 0 ? "ctrl" : rank == rAgg ? "agg" : rank == rIng ? "ing" : "pred";
+    char who[32];
+    std::snprintf(who, sizeof(who), "rank=%d ", rank);
+    perf::report(stdout, who);
+    const size_t rss = peak_rss_bytes();
+    std::fprintf(stderr, "[MEM] rank=%d role=%s peak-rss=%.1fMB per-junction=%.0fB\n", rank, role,
+                 rss / 1048576.0, (double)rss / J);
   }
 
+  // Collective teardown (MPI_Win_free) before finalize.
+  chIA.reset();
+  chAP.clear();
+  chPC.clear();
+  if (node != MPI_COMM_NULL)
+    MPI_Comm_free(&node);
+  table.reset();
   MPI_Finalize();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+// dist/pred_table.cpp
+#include "dist/pred_table.h"
+#include <algorithm>
+
+namespace
+{
+  constexpr int kDescWords = sizeof(SliceDesc) / sizeof(uint32_t);
+  static_assert(sizeof(SliceDesc) % sizeof(uint32_t) == 0, "SliceDesc must be whole words");
+}
+
+PredTable::PredTable(MPI_Comm comm, int owner, uint32_t junctions, int slices, int planes)
+    : comm_(comm), owner_(owner), junctions_(junctions), slices_(slices), planes_(planes < 1 ? 1 : planes)
+{
+  MPI_Comm_rank(comm_, &rank_);
+  const bool own = (rank_ == owner_);
+
+  const MPI_Aint rows_bytes = own ? static_cast<MPI_Aint>(sizeof(Prediction)) * junctions_ * planes_ : 0;
+  const MPI_Aint desc_bytes = own ? static_cast<MPI_Aint>(sizeof(SliceDesc)) * slices_ * planes_ : 0;
+
+  MPI_Win_allocate(rows_bytes, sizeof(Prediction), MPI_INFO_NULL, comm_, &rows_, &win_rows_);
+  MPI_Win_allocate(desc_bytes, sizeof(uint32_t), MPI_INFO_NULL, comm_, &descs_, &win_desc_);
+
+  if (own)
+  {
+    // First-touch here so the owner's pages are resident before tick 0.
+    for (size_t i = 0, n = static_cast<size_t>(junctions_) * planes_; i < n; ++i)
+      rows_[i] = Prediction{};
+    for (size_t i = 0, n = static_cast<size_t>(slices_) * planes_; i < n; ++i)
+      descs_[i] = SliceDesc{};
+    ready_.assign(slices_, 0);
+    ready_desc_.assign(slices_, nullptr);
+  }
+
+  // Everyone has initialised before anyone writes; then hold one passive-target
+  // epoch open for the lifetime of the table.
+  MPI_Barrier(comm_);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, win_rows_);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, win_desc_);
+}
+
+PredTable::~PredTable()
+{
+  MPI_Win_unlock_all(win_desc_);
+  MPI_Win_unlock_all(win_rows_);
+  MPI_Win_free(&win_desc_);
+  MPI_Win_free(&win_rows_);
+}
+
+void PredTable::put_slice(int slice, uint32_t tick_id, const std::vector<Prediction> &preds)
+{
+  const uint32_t n = static_cast<uint32_t>(preds.size());
+  const int plane = static_cast<int>(tick_id % static_cast<uint32_t>(planes_));
+
+  SliceDesc d{};
+  d.epoch = tick_id + 1;
+  d.n = n;
+  d.j0 = n ? preds[0].junction : 0;
+  d.stride = (n > 1) ? static_cast<uint32_t>(preds[1].junction - preds[0].junction) : 1;
+  if (d.stride == 0)
+    d.stride = 1;
+
+  if (n > 0)
+  {
+    // The aggregator cuts slices as arithmetic progressions over junction ids,
+    // so one strided vector type places the whole slice with a single Put.
+    MPI_Datatype tgt;
+    const int row_bytes = static_cast<int>(sizeof(Prediction));
+    MPI_Type_vector(static_cast<int>(n), row_bytes, row_bytes * static_cast<int>(d.stride), MPI_BYTE, &tgt);
+    MPI_Type_commit(&tgt);
+    const MPI_Aint disp = static_cast<MPI_Aint>(plane) * junctions_ + d.j0;
+    MPI_Put(preds.data(), static_cast<int>(n) * row_bytes, MPI_BYTE, owner_, disp, 1, tgt, win_rows_);
+    MPI_Type_free(&tgt);
+  }
+
+  // Descriptor body, then flush both windows so rows + body land before epoch.
+  const MPI_Aint ddisp = (static_cast<MPI_Aint>(plane) * slices_ + slice) * kDescWords;
+  MPI_Put(&d.j0, kDescWords - 1, MPI_UINT32_T, owner_, ddisp + 1, kDescWords - 1, MPI_UINT32_T, win_desc_);
+  MPI_Win_flush(owner_, win_rows_);
+  MPI_Win_flush(owner_, win_desc_);
+
+  MPI_Accumulate(&d.epoch, 1, MPI_UINT32_T, owner_, ddisp, 1, MPI_UINT32_T, MPI_REPLACE, win_desc_);
+  MPI_Win_flush(owner_, win_desc_);
+}
+
+uint32_t PredTable::epoch(int plane, int slice) const
+{
+  // Predictors bump epochs with MPI_Accumulate while the owner reads them.
+  return __atomic_load_n(&descs_[static_cast<size_t>(plane) * slices_ + slice].epoch, __ATOMIC_ACQUIRE);
+}
+
+int64_t PredTable::freshest_complete(int64_t after)
+{
+  MPI_Win_sync(win_desc_);
+  int64_t best = -1;
+  for (int p = 0; p < planes_; ++p)
+  {
+    const uint32_t e = epoch(p, 0);
+    if (e == 0 || static_cast<int64_t>(e) - 1 <= std::max(after, best))
+      continue;
+    bool all = true;
+    for (int s = 1; s < slices_ && all; ++s)
+      all = epoch(p, s) == e;
+    if (all)
+      best = static_cast<int64_t>(e) - 1;
+  }
+  return best;
+}
+
+int64_t PredTable::freshest_any(int64_t after)
+{
+  MPI_Win_sync(win_desc_);
+  int64_t best = -1;
+  for (int p = 0; p < planes_; ++p)
+    for (int s = 0; s < slices_; ++s)
+      if (const int64_t t = static_cast<int64_t>(epoch(p, s)) - 1; t > after)
+        best = std::max(best, t);
+  return best;
+}
+
+int PredTable::gather(uint32_t tick)
+{
+  MPI_Win_sync(win_desc_);
+  const int plane = static_cast<int>(tick % static_cast<uint32_t>(planes_));
+  plane_ = plane;
+  int done = 0;
+  for (int s = 0; s < slices_; ++s)
+  {
+    const bool ok = epoch(plane, s) == tick + 1;
+    ready_[s] = ok;
+    ready_desc_[s] = ok ? &descs_[static_cast<size_t>(plane) * slices_ + s] : nullptr;
+    done += ok;
+  }
+  if (done)
+    MPI_Win_sync(win_rows_);
+  return done;
+}
+
+const Prediction *PredTable::row(int slice) const
+{
+  return rows_ + static_cast<size_t>(plane_) * junctions_ + ready_desc_[slice]->j0;
+}
@@ -0,0 +1,83 @@
+// dist/pred_table.h
+#pragma once
+#include <mpi.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "common/schema.h"
+
+// Per-slice completion record, written by a predictor after its data Put.
+// `epoch` is published last (atomic MPI_REPLACE) so a non-zero epoch implies
+// the prediction rows and the remaining fields are already visible.
+struct SliceDesc
+{
+  uint32_t epoch;  // tick_id + 1 of the last completed write (0 = never)
+  uint32_t j0;     // first junction id in the slice
+  uint32_t n;      // number of predictions
+  uint32_t stride; // junction stride (aggregator thinning)
+};
+
+// Junction-indexed global prediction table exposed by one rank (the controller)
+// through MPI one-sided RMA. Predictors MPI_Put their slice straight into place
+// and then bump the slice epoch; the owner polls epochs and reads in place.
+//
+// Rows are double-buffered by tick parity (`planes`) so a predictor writing
+// tick t+1 never overwrites rows the controller is still acting on for tick t.
+// Tick t lives in plane t % planes, so a tick is complete when every slice
+// descriptor of that plane carries epoch t+1: the owner acts on one tick at
+// a time and never mixes slices (or, with DIST_BALANCE, slice bounds) from
+// different ticks.
+//
+// One writer per slice and tick: the rows are plain MPI_Puts, so two ranks
+// must never publish the same slice of the same tick (no DIST_HEDGE).
+class PredTable
+{
+public:
+  // Collective over `comm`: every rank must construct it. Only `owner` backs
+  // the windows with memory; everyone else allocates zero bytes.
+  PredTable(MPI_Comm comm, int owner, uint32_t junctions, int slices, int planes = 2);
+  ~PredTable();
+  PredTable(const PredTable &) = delete;
+  PredTable &operator=(const PredTable &) = delete;
+
+  // Predictor side: publish `preds` (ascending junction ids in an arithmetic
+  // progression, as cut by the aggregator) as slice `slice` of tick `tick_id`.
+  void put_slice(int slice, uint32_t tick_id, const std::vector<Prediction> &preds);
+
+  // Owner side: newest tick after `after` whose every slice has published
+  // (-1 if none), and newest tick after `after` with at least one slice.
+  [[nodiscard]] int64_t freshest_complete(int64_t after);
+  [[nodiscard]] int64_t freshest_any(int64_t after);
+
+  // Owner side: completion bitmap of `tick` (slices whose descriptor in the
+  // tick's plane carries its epoch). Returns the number of slices set.
+  int gather(uint32_t tick);
+  [[nodiscard]] bool slice_ready(int slice) const { return ready_[slice] != 0; }
+
+  // Owner side: descriptor and first row of a slice set by gather(). Rows are
+  // laid out by junction id, so slice rows sit at row(slice)[k * desc.stride].
+  [[nodiscard]] const SliceDesc &desc(int slice) const { return *ready_desc_[slice]; }
+  [[nodiscard]] const Prediction *row(int slice) const;
+
+  [[nodiscard]] int slices() const { return slices_; }
+
+private:
+  MPI_Comm comm_;
+  int owner_;
+  int rank_ = 0;
+  uint32_t junctions_;
+  int slices_;
+  int planes_;
+
+  MPI_Win win_rows_ = MPI_WIN_NULL;
+  MPI_Win win_desc_ = MPI_WIN_NULL;
+  Prediction *rows_ = nullptr; // [planes][junctions] (owner only)
+  SliceDesc *descs_ = nullptr; // [planes][slices]    (owner only)
+
+  // Owner bookkeeping
+  std::vector<uint8_t> ready_;               // completion bitmap of the gathered tick
+  std::vector<const SliceDesc *> ready_desc_; // its descriptor per ready slice
+  int plane_ = 0;                             // plane of the gathered tick
+
+  [[nodiscard]] uint32_t epoch(int plane, int slice) const;
+};
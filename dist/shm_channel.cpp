@@ -0,0 +1,81 @@
+// dist/shm_channel.cpp
+#include "dist/shm_channel.h"
+#include <new>
+
+ShmChannel::ShmChannel(MPI_Comm node, int producer, int consumer, size_t slot_bytes, int slots)
+    : slot_bytes_((slot_bytes + 63) & ~size_t(63)), slots_(slots < 1 ? 1 : slots)
+{
+  // Translate both endpoints into the node communicator; if either is on
+  // another node every rank here agrees to skip the (collective) allocation.
+  MPI_Group gworld, gnode;
+  MPI_Comm_group(MPI_COMM_WORLD, &gworld);
+  MPI_Comm_group(node, &gnode);
+  const int world_ranks[2] = {producer, consumer};
+  int node_ranks[2] = {MPI_UNDEFINED, MPI_UNDEFINED};
+  MPI_Group_translate_ranks(gworld, 2, world_ranks, gnode, node_ranks);
+  MPI_Group_free(&gworld);
+  MPI_Group_free(&gnode);
+  if (node_ranks[0] == MPI_UNDEFINED || node_ranks[1] == MPI_UNDEFINED)
+    return;
+
+  int me = 0;
+  MPI_Comm_rank(node, &me);
+  const bool own = (me == node_ranks[1]);
+  const MPI_Aint bytes = own ? static_cast<MPI_Aint>(kHeaderBytes + slot_bytes_ * slots_) : 0;
+
+  MPI_Info info;
+  MPI_Info_create(&info);
+  MPI_Info_set(info, "alloc_shared_noncontig", "true");
+  void *mine = nullptr;
+  MPI_Win_allocate_shared(bytes, 1, info, node, &mine, &win_);
+  MPI_Info_free(&info);
+
+  MPI_Aint seg = 0;
+  int disp = 0;
+  void *base = nullptr;
+  MPI_Win_shared_query(win_, node_ranks[1], &seg, &disp, &base);
+  hdr_ = static_cast<Header *>(base);
+  slots_base_ = static_cast<unsigned char *>(base) + kHeaderBytes;
+  if (own)
+    new (hdr_) Header{0};
+
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+  MPI_Win_sync(win_);
+  MPI_Barrier(node);
+  MPI_Win_sync(win_);
+}
+
+ShmChannel::~ShmChannel()
+{
+  if (win_ == MPI_WIN_NULL)
+    return;
+  MPI_Win_unlock_all(win_);
+  MPI_Win_free(&win_);
+}
+
+void *ShmChannel::try_acquire()
+{
+  if (!local())
+    return nullptr;
+  if (pub_seq_ - hdr_->released.load(std::memory_order_acquire) >= static_cast<uint64_t>(slots_))
+    return nullptr; // consumer still holds every slot
+  return slots_base_ + (pub_seq_ % slots_) * slot_bytes_;
+}
+
+void ShmChannel::publish()
+{
+  MPI_Win_sync(win_);
+  ++pub_seq_;
+}
+
+const void *ShmChannel::peek(size_t k)
+{
+  MPI_Win_sync(win_);
+  return slots_base_ + ((con_seq_ + k) % slots_) * slot_bytes_;
+}
+
+void ShmChannel::release()
+{
+  ++con_seq_;
+  hdr_->released.store(con_seq_, std::memory_order_release);
+}
@@ -0,0 +1,61 @@
+// dist/shm_channel.h
+#pragma once
+#include <mpi.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// One-way producer -> consumer payload channel over an MPI-3 shared-memory
+// window (MPI_Win_allocate_shared), used when both ranks sit on the same node.
+//
+// The producer writes a tick's payload straight into a slot and the consumer
+// reads it in place; a header-only frame (dist/link.h) is the notification.
+// Slots form a ring of `slots` entries; the consumer frees them with
+// release(). When the ring is full (or the ranks are on different nodes)
+// try_acquire() returns nullptr and the payload travels inside the frame
+// instead, so a slow consumer can never deadlock the producer.
+class ShmChannel
+{
+public:
+  // Collective over `node` (MPI_Comm_split_type(MPI_COMM_TYPE_SHARED)); every
+  // rank of the node constructs every channel in the same order. Ranks are
+  // MPI_COMM_WORLD ranks. The consumer owns (and first-touches) the segment.
+  ShmChannel(MPI_Comm node, int producer, int consumer, size_t slot_bytes, int slots = 2);
+  ~ShmChannel();
+  ShmChannel(const ShmChannel &) = delete;
+  ShmChannel &operator=(const ShmChannel &) = delete;
+
+  // True when both endpoints share this node and the segment exists.
+  [[nodiscard]] bool local() const { return win_ != MPI_WIN_NULL; }
+  [[nodiscard]] size_t slot_bytes() const { return slot_bytes_; }
+
+  // Producer: next free slot, or nullptr if the ring is full / not local.
+  void *try_acquire();
+  template <typename T>
+  T *try_acquire() { return static_cast<T *>(try_acquire()); }
+  // Producer: make the acquired slot visible; call before the notification.
+  void publish();
+
+  // Consumer: the k-th oldest unreleased in-slot payload (k = 0 is the one
+  // the earliest "in shared memory" notification refers to). Read it in
+  // place, then release() slots oldest-first.
+  const void *peek(size_t k = 0);
+  template <typename T>
+  const T *peek(size_t k = 0) { return static_cast<const T *>(peek(k)); }
+  void release();
+
+private:
+  struct Header
+  {
+    std::atomic<uint64_t> released; // slots freed by the consumer
+  };
+  static constexpr size_t kHeaderBytes = 64;
+
+  MPI_Win win_ = MPI_WIN_NULL;
+  Header *hdr_ = nullptr;
+  unsigned char *slots_base_ = nullptr;
+  size_t slot_bytes_;
+  int slots_;
+  uint64_t pub_seq_ = 0; // producer: slots published
+  uint64_t con_seq_ = 0; // consumer: slots released
+};
@@ -3,24 +3,42 @@
 #include <cmath>
 #include <algorithm>
 
-Ingestor::Ingestor(const IngestConfig& cfg) : cfg_(cfg), rng_(12345) {}
+Ingestor::Ingestor(const IngestConfig& cfg)
+    : cfg_(cfg),
+      lanes_(cfg.lanes ? cfg.lanes : std::make_shared<const LaneIndex>(LaneIndex::uniform(cfg.junctions, cfg.lanes_per))),
+      rng_(12345) {}
 
 void Ingestor::generate(uint32_t tick_id, std::vector<SensorSample>& out) {
-  out.clear();
-  out.reserve(cfg_.junctions * cfg_.lanes_per);
+  out.resize(samples_per_tick());
+  generate(tick_id, out.data());
+}
+
+size_t Ingestor::generate(uint32_t tick_id, SensorSample* out) {
+  return generate(tick_id, 0, cfg_.junctions, out);
+}
 
-  std::uniform_int_distribution<int> base(0, 10);
-  std::normal_distribution<float> rush(0.f, 1.f);
+size_t Ingestor::generate(uint32_t tick_id, uint32_t j0, uint32_t j1, SensorSample* out) {
+  size_t k = 0;
+
+  // Fresh distributions per tick (normal_distribution caches its second
+  // draw), carried across the blocks of one tick so they match a whole tick.
+  if (j0 == 0) {
+    base_.reset();
+    rush_.reset();
+  }
+  auto &base = base_;
+  auto &rush = rush_;
 
   // simple diurnal pattern + noise
   float hour = std::fmod((tick_id / 3600.f), 24.f);
   float peak = (hour > 7 && hour < 9) || (hour > 16 && hour < 18) ? 1.5f : 1.0f;
 
-  for (uint32_t j = 0; j < cfg_.junctions; ++j) {
-    for (uint32_t l = 0; l < cfg_.lanes_per; ++l) {
+  // Samples follow the CSR lane layout: junction j's lanes are contiguous.
+  for (uint32_t j = j0; j < j1; ++j) {
+    for (uint32_t l = 0, nl = lanes_->lanes(j); l < nl; ++l) {
       SensorSample s{};
       s.ts_ms = tick_id * cfg_.tick_ms;
-      s.junction = (uint16_t)j;
+      s.junction = j;
       s.lane = (uint16_t)l;
 
       int b = base(rng_);
@@ -33,7 +51,8 @@ void Ingestor::generate(uint32_t tick_id, std::vector<SensorSample>& out) {
       s.arrivals  = (uint16_t)arrivals10;
       s.q_len     = (uint16_t)q;
       s.avg_speed = (uint16_t)speed10;
-      out.push_back(s);
+      out[k++] = s;
     }
   }
+  return k;
 }
@@ -1,15 +1,19 @@
 // ingest/ingest.h
 #pragma once
 #include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <random>
+#include <memory>
 #include "common/schema.h"
+#include "common/lanes.h"
 
 struct IngestConfig
 {
   uint32_t junctions = 500;
   uint32_t lanes_per = 3;
-  uint32_t tick_ms = 1000; // control tick
+  uint32_t tick_ms = 1000;               // control tick
+  std::shared_ptr<const LaneIndex> lanes; // per-junction lanes (null = lanes_per each)
 };
 
 class Ingestor
@@ -17,8 +21,20 @@ class Ingestor
 public:
   explicit Ingestor(const IngestConfig &cfg);
   void generate(uint32_t tick_id, std::vector<SensorSample> &out);
+  // Write one tick straight into caller storage (e.g. a shared-memory slot)
+  // of at least samples_per_tick() entries; returns the count written.
+  size_t generate(uint32_t tick_id, SensorSample *out);
+  // Streaming: junctions [j0, j1) of a tick only (their lanes, in order).
+  // Blocks of a tick must be generated in junction order; together they
+  // produce exactly the samples of the whole-tick call.
+  size_t generate(uint32_t tick_id, uint32_t j0, uint32_t j1, SensorSample *out);
+  size_t samples_per_tick() const { return lanes_->samples(); }
+  const LaneIndex &lanes() const { return *lanes_; }
 
 private:
   IngestConfig cfg_;
+  std::shared_ptr<const LaneIndex> lanes_;
   std::mt19937 rng_;
+  std::uniform_int_distribution<int> base_{0, 10};
+  std::normal_distribution<float> rush_{0.f, 1.f};
 };
\ No newline at end of file
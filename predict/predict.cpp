@@ -1,5 +1,6 @@
 // predict/predict.cpp
 #include "predict/predict.h"
+#include "common/perf.h"
 #include <algorithm>
 #include <cmath>
 #include <cstring>
@@ -34,6 +35,20 @@ struct Predictor::ClCtx
   int F_cap = 0; // feature width capacity (should be 6 here)
 };
 
+// tiny linear model over f0..f5
+static constexpr int kF = packed::kFeatures;
+static constexpr float kW[kF] = {0.06f, 0.04f, -0.05f, 0.08f, 0.02f, 0.02f};
+static constexpr float kBias = 0.1f;
+
+static inline Prediction predict_row(const Features &f)
+{
+  float z = kBias;
+  for (int j = 0; j < kF; ++j)
+    z += f.f[j] * kW[j];
+  const float y = 1.f / (1.f + std::exp(-z));
+  return Prediction{f.ts_ms, f.junction, std::min(std::max(y, 0.f), 1.f)};
+}
+
 // Same kernel as predict/kernels.cl so the code is self-contained.
 static const char *KERNEL_SRC = R"CLC(
 __kernel void infer_linear(__global const float* X,
@@ -170,40 +185,118 @@ void Predictor::init_opencl_if_possible()
   }
 }
 
-void Predictor::cpu_predict(const std::vector<Features> &feats, std::vector<Prediction> &out)
+void Predictor::cpu_predict(const Features *feats, size_t n, std::vector<Prediction> &out)
 {
-  out.resize(feats.size());
+  out.resize(n);
 
-  // tiny linear model over f0..f5
-  constexpr int F = 6;
-  const float W[F] = {0.06f, 0.04f, -0.05f, 0.08f, 0.02f, 0.02f};
-  const float bias = 0.1f;
+#pragma omp parallel
+  {
+    perf::Region r("pred.cpu");
+#pragma omp for
+    for (int i = 0; i < static_cast<int>(n); ++i)
+      out[i] = predict_row(feats[i]);
+  }
+}
 
-#pragma omp parallel for
-  for (int i = 0; i < static_cast<int>(feats.size()); ++i)
+size_t Predictor::predict_batch(const Features *feats, size_t n, const Deadline &dl, std::vector<Prediction> &out)
+{
+  if (n == 0)
   {
-    float z = bias;
-    for (int j = 0; j < F; ++j)
-      z += feats[i].f[j] * W[j];
-    const float y = 1.f / (1.f + std::exp(-z));
-    out[i] = Prediction{feats[i].ts_ms, feats[i].junction, std::min(std::max(y, 0.f), 1.f)};
+    out.clear();
+    return 0;
   }
+  const uint64_t us0 = now_us();
+  auto note_rate = [&](size_t rows)
+  {
+    const double r = static_cast<double>(rows) * 1000.0 / static_cast<double>(std::max<uint64_t>(1, now_us() - us0));
+    rows_per_ms_ = rows_per_ms_ > 0.0 ? 0.7 * rows_per_ms_ + 0.3 * r : r;
+  };
+
+  // The hottest-first order costs a pass over the rows and scattered reads
+  // after it. When the measured throughput says the whole slice fits in half
+  // of what is left of the budget, nothing would be cut: run it in id order
+  // through the regular path (OpenCL when it is up).
+  if (rows_per_ms_ > 0.0 && static_cast<double>(n) <= 0.5 * rows_per_ms_ * dl.remaining())
+  {
+    predict_batch(feats, n, out);
+    note_rate(n);
+    return n;
+  }
+  out.resize(n);
+
+  // Priority order by a counting sort over kBuckets score bands: O(n), and
+  // only the order between blocks matters. Rows of one band stay in id
+  // order, which keeps the feature reads close to sequential. Scores are
+  // taken in one pass over the rows; the sort itself only touches score_.
+  constexpr int kBuckets = 64;
+  score_.resize(n);
+  float lo = feats[0].f[0] + 0.5f * feats[0].f[3], hi = lo;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const float s = feats[i].f[0] + 0.5f * feats[i].f[3];
+    score_[i] = s;
+    lo = std::min(lo, s);
+    hi = std::max(hi, s);
+  }
+  const float to_band = hi > lo ? (kBuckets - 1) / (hi - lo) : 0.f;
+  auto band = [&](size_t i) // 0 = hottest
+  { return kBuckets - 1 - std::min(kBuckets - 1, static_cast<int>((score_[i] - lo) * to_band)); };
+  bucket_.assign(kBuckets + 1, 0);
+  for (size_t i = 0; i < n; ++i)
+    bucket_[band(i) + 1]++;
+  for (int b = 0; b < kBuckets; ++b)
+    bucket_[b + 1] += bucket_[b];
+  order_.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    order_[bucket_[band(i)]++] = static_cast<uint32_t>(i);
+
+  // One team for the whole slice: each block is a worksharing loop, and one
+  // thread checks the clock between blocks for everyone (the barrier after
+  // `single` publishes `stop`). The first block always runs.
+  size_t done = 0;
+  bool stop = false;
+#pragma omp parallel
+  {
+    perf::Region r("pred.anytime");
+    while (!stop)
+    {
+      const int m = static_cast<int>(std::min(kAnytimeBlock, n - done));
+      const uint32_t *rows = order_.data() + done;
+      Prediction *dst = out.data() + done;
+#pragma omp for
+      for (int i = 0; i < m; ++i)
+        dst[i] = predict_row(feats[rows[i]]);
+#pragma omp single
+      {
+        done += static_cast<size_t>(m);
+        stop = done >= n || dl.expired();
+      }
+    }
+  }
+  out.resize(done);
+  note_rate(done);
+  return done;
 }
 
 void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Prediction> &out)
 {
-  if (!has_cl_ || feats.empty())
+  predict_batch(feats.data(), feats.size(), out);
+}
+
+void Predictor::predict_batch(const Features *feats, size_t n, std::vector<Prediction> &out)
+{
+  if (!has_cl_ || n == 0)
   {
-    cpu_predict(feats, out);
+    cpu_predict(feats, n, out);
     return;
   }
 
   // OpenCL path (same model as CPU path)
-  constexpr int F = 6;
-  const float W[F] = {0.06f, 0.04f, -0.05f, 0.08f, 0.02f, 0.02f};
-  const float bias = 0.1f;
+  constexpr int F = kF;
+  const float *W = kW;
+  const float bias = kBias;
 
-  const int B = static_cast<int>(feats.size());
+  const int B = static_cast<int>(n);
   std::vector<float> X;
   X.resize(static_cast<size_t>(B) * F);
 
@@ -226,21 +319,21 @@ void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Pr
     cl_->dX = clCreateBuffer(cl_->ctx, CL_MEM_READ_ONLY, sizeof(float) * B * F, nullptr, &err);
     if (!cl_->dX || err != CL_SUCCESS)
     {
-      cpu_predict(feats, out);
+      cpu_predict(feats, n, out);
       return;
     }
 
     cl_->dW = clCreateBuffer(cl_->ctx, CL_MEM_READ_ONLY, sizeof(float) * F, nullptr, &err);
     if (!cl_->dW || err != CL_SUCCESS)
     {
-      cpu_predict(feats, out);
+      cpu_predict(feats, n, out);
       return;
     }
 
     cl_->dO = clCreateBuffer(cl_->ctx, CL_MEM_WRITE_ONLY, sizeof(float) * B, nullptr, &err);
     if (!cl_->dO || err != CL_SUCCESS)
     {
-      cpu_predict(feats, out);
+      cpu_predict(feats, n, out);
       return;
     }
 
@@ -251,12 +344,12 @@ void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Pr
   // Upload X, W
   if (clEnqueueWriteBuffer(cl_->q, cl_->dX, CL_TRUE, 0, sizeof(float) * B * F, X.data(), 0, nullptr, nullptr) != CL_SUCCESS)
   {
-    cpu_predict(feats, out);
+    cpu_predict(feats, n, out);
     return;
   }
   if (clEnqueueWriteBuffer(cl_->q, cl_->dW, CL_TRUE, 0, sizeof(float) * F, W, 0, nullptr, nullptr) != CL_SUCCESS)
   {
-    cpu_predict(feats, out);
+    cpu_predict(feats, n, out);
     return;
   }
 
@@ -271,7 +364,7 @@ void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Pr
   size_t g = static_cast<size_t>(B);
   if (clEnqueueNDRangeKernel(cl_->q, cl_->kern, 1, nullptr, &g, nullptr, 0, nullptr, nullptr) != CL_SUCCESS)
   {
-    cpu_predict(feats, out);
+    cpu_predict(feats, n, out);
     return;
   }
   clFinish(cl_->q);
@@ -280,7 +373,7 @@ void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Pr
   std::vector<float> O(B);
   if (clEnqueueReadBuffer(cl_->q, cl_->dO, CL_TRUE, 0, sizeof(float) * B, O.data(), 0, nullptr, nullptr) != CL_SUCCESS)
   {
-    cpu_predict(feats, out);
+    cpu_predict(feats, n, out);
     return;
   }
 
@@ -295,4 +388,85 @@ void Predictor::predict_batch(const std::vector<Features> &feats, std::vector<Pr
       y = 1.f;
     out[i] = Prediction{feats[i].ts_ms, feats[i].junction, y};
   }
-}
\ No newline at end of file
+}
+
+size_t Predictor::predict_packed(const void *in, void *out)
+{
+  const auto &h = *static_cast<const packed::FeatureHdr *>(in);
+  auto &ph = *static_cast<packed::PredHdr *>(out);
+  ph = packed::PredHdr{h.ts_ms, h.j0, h.stride, h.rows};
+  uint16_t *q_out = packed::pred_column(out);
+
+  // Fold each feature's dequantisation into the model:
+  //   sum W[k] * (q[k] * scale[k] + offset[k]) + bias = sum w[k] * q[k] + b
+  // so the kernel runs on the quantized columns as they arrived.
+  float w[kF];
+  float b = kBias;
+  for (int k = 0; k < kF; ++k)
+  {
+    w[k] = kW[k] * h.scale[k];
+    b += kW[k] * h.offset[k];
+  }
+
+  const int blocks = static_cast<int>((h.rows + packed::kBlock - 1) / packed::kBlock);
+#pragma omp parallel
+  {
+    perf::Region r("pred.packed");
+#pragma omp for
+    for (int blk = 0; blk < blocks; ++blk)
+    {
+      const size_t i0 = static_cast<size_t>(blk) * packed::kBlock;
+      const size_t n = std::min<size_t>(packed::kBlock, h.rows - i0);
+      float q[packed::kBlock], z[packed::kBlock];
+      std::fill(z, z + n, b);
+      for (int k = 0; k < kF; ++k)
+      {
+        packed::load_column(h, k, i0, n, q);
+        const float wk = w[k];
+#pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+          z[i] += wk * q[i];
+      }
+      for (size_t i = 0; i < n; ++i)
+        z[i] = 1.f / (1.f + std::exp(-z[i]));
+      packed::to_fixed16(z, q_out + i0, n); // clamps to [0, 1]
+    }
+  }
+  return packed::pred_bytes(h.rows);
+}
+
+PackCheck Predictor::check_packed(packed::Format fmt, const Features *feats, size_t n)
+{
+  PackCheck c;
+  c.rows = n;
+  if (n == 0)
+    return c;
+
+  std::vector<Prediction> ref, got(n);
+  cpu_predict(feats, n, ref);
+  std::vector<unsigned char> fbuf(packed::feature_bytes(fmt, n)), pbuf(packed::pred_bytes(n));
+  packed::pack_features(fmt, feats, n, 1, fbuf.data());
+  predict_packed(fbuf.data(), pbuf.data());
+  packed::unpack_predictions(pbuf.data(), got.data());
+
+  float best_ref = -1.f, best_got = -1.f;
+  double sum = 0.0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const double e = std::fabs(static_cast<double>(got[i].congestion_60s) - ref[i].congestion_60s);
+    sum += e;
+    c.max_err = std::max(c.max_err, e);
+    if (ref[i].congestion_60s > best_ref)
+    {
+      best_ref = ref[i].congestion_60s;
+      c.top0_fp32 = ref[i].junction;
+    }
+    if (got[i].congestion_60s > best_got)
+    {
+      best_got = got[i].congestion_60s;
+      c.top0_packed = got[i].junction;
+    }
+  }
+  c.mean_err = sum / static_cast<double>(n);
+  return c;
+}
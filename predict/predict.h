@@ -1,7 +1,20 @@
 // predict/predict.h
 #pragma once
 #include <vector>
+#include <cstddef>
+#include "common/packed.h"
 #include "common/schema.h"
+#include "common/timers.h"
+
+// Reduced-precision path against fp32 on the same rows (DIST_PACK report).
+struct PackCheck
+{
+  size_t rows = 0;
+  double max_err = 0.0;  // |congestion_packed - congestion_fp32|
+  double mean_err = 0.0;
+  uint32_t top0_fp32 = 0; // hottest junction by either path
+  uint32_t top0_packed = 0;
+};
 
 struct PredConfig
 {
@@ -17,6 +30,24 @@ public:
 
   // Predict congestion in 60s horizon [0..1]
   void predict_batch(const std::vector<Features> &feats, std::vector<Prediction> &out);
+  // Same, reading features in place (e.g. from a shared-memory slot).
+  void predict_batch(const Features *feats, size_t n, std::vector<Prediction> &out);
+  // Anytime variant (CPU): rows go hottest first by the reduce_topN score
+  // (queue + 0.5 * EWMA queue), kAnytimeBlock at a time, and `dl` is checked
+  // between blocks. `out` holds the finished rows in that order, each with
+  // its junction id; returns how many (n when the budget sufficed). The
+  // first block always runs, so the hottest junctions are never skipped.
+  // Slices that comfortably fit the budget at the measured rate go through
+  // the regular predict_batch instead (id order, OpenCL when it is up).
+  size_t predict_batch(const Features *feats, size_t n, const Deadline &dl, std::vector<Prediction> &out);
+  static constexpr size_t kAnytimeBlock = 1024;
+
+  // Same model over a packed feature slice (common/packed.h), without
+  // expanding it: writes a packed prediction slice to `out` and returns its
+  // size in bytes. CPU only.
+  size_t predict_packed(const void *in, void *out);
+  // Run `feats` through both paths and compare.
+  PackCheck check_packed(packed::Format fmt, const Features *feats, size_t n);
 
 private:
   PredConfig cfg_;
@@ -26,6 +57,11 @@ private:
   struct ClCtx;
   ClCtx *cl_ = nullptr;
 
-  void cpu_predict(const std::vector<Features> &feats, std::vector<Prediction> &out);
+  std::vector<uint32_t> order_; // anytime: row indices, hottest first
+  std::vector<float> score_;
+  std::vector<uint32_t> bucket_;
+  double rows_per_ms_ = 0.0; // anytime: smoothed throughput of the last slices
+
+  void cpu_predict(const Features *feats, size_t n, std::vector<Prediction> &out);
   void init_opencl_if_possible();
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+# scripts/scale_check.sh
+#!/usr/bin/env bash
+# Metro-scale check: run dist at JUNCTIONS (default 1M) and fail if any rank's
+# peak memory per junction or any steady-state tick latency exceeds budget.
+# The first tick is warm-up (page faults on every buffer) and is not judged.
+#
+#   JUNCTIONS=1000000 MEM_PER_JUNCTION=1024 TICK_MS=1000 scripts/scale_check.sh
+set -euo pipefail
+export PATH="/opt/homebrew/bin:${PATH}"
+
+J="${JUNCTIONS:-1000000}"
+TICK="${TICK_MS:-1000}"
+MEM_B="${MEM_PER_JUNCTION:-1024}" # bytes per junction, any single rank
+NP="${NP:-5}"                     # ctrl + 2 predictors + agg + ing
+LOG="${LOG:-scale_${J}.log}"
+
+make dist
+mpirun --oversubscribe -np "$NP" -x JUNCTIONS="$J" -x TICK_MS="$TICK" ./bin/dist_twin >"$LOG" 2>&1
+
+awk -v J="$J" -v tick="$TICK" -v mem="$MEM_B" '
+  /\[CTRL\] tick/ {
+    t = $3 + 0
+    split($6, got, "/")
+    lat = $0; sub(/.*lat=/, "", lat); lat += 0
+    n++
+    if (t > 0) {
+      if (lat > maxlat) maxlat = lat
+      if (got[1] + 0 < got[2] + 0) missed++
+    }
+  }
+  /\[MEM\]/ {
+    pj = $0; sub(/.*per-junction=/, "", pj); pj += 0
+    if (pj > maxmem) { maxmem = pj; who = $3 }
+  }
+  END {
+    printf("[SCALE] junctions=%d ticks=%d max-lat=%dms (budget %d) missed=%d max-mem=%dB/junction %s (budget %d)\n",
+           J, n, maxlat, tick, missed, maxmem, who, mem)
+    if (n == 0 || maxlat > tick || missed > 0 || maxmem > mem) { print "[SCALE] FAIL"; exit 1 }
+    print "[SCALE] OK"
+  }' "$LOG"
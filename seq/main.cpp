@@ -3,42 +3,83 @@
 #include <vector>
 #include <cstdio>
 #include <algorithm>
+#include <string>
+#include "common/config.h"
+#include "common/perf.h"
+#include "common/results.h"
 #include "common/timers.h"
 #include "ingest/ingest.h"
 #include "aggregate/aggregate.h"
 #include "predict/predict.h"
 #include "control/control.h"
+#include "control/cmd_stream.h"
 
-int main()
+int main(int argc, char **argv)
 {
-  IngestConfig icfg{.junctions = 20000, .lanes_per = 3, .tick_ms = 1000};
-  AggConfig acfg{.junctions = icfg.junctions, .lanes_per = icfg.lanes_per};
-  PredConfig pcfg{.prefer_opencl = false};
+  // Scenario from --options / environment (common/config.h); the defaults
+  // are the original fixed run: 20000 junctions, 20 ticks.
+  TwinConfig cfg;
+  cfg.variant = "seq";
+  if (std::string err; !cfg.parse(argc, argv, err))
+  {
+    if (!err.empty())
+      std::fprintf(stderr, "seq_twin: %s\n", err.c_str());
+    TwinConfig::usage(stderr, argv[0]);
+    return err.empty() ? 0 : 2;
+  }
+  cfg.print(stderr);
+
+  // --lanes=<lo>-<hi> / --lanes-file=<path>: per-junction lane counts (default 3).
+  auto lanes = cfg.lane_index();
+  IngestConfig icfg{.junctions = cfg.junctions, .lanes_per = 3, .tick_ms = cfg.tick_ms, .lanes = lanes};
+  // GRAPH_FILE=<path>: "src dst [weight]" edges for the upstream features.
+  AggConfig acfg{.junctions = icfg.junctions, .lanes_per = icfg.lanes_per, .lanes = lanes,
+                 .window = {cfg.win_short, cfg.win_long}, .graph = JunctionGraph::from_env(icfg.junctions)};
+  PredConfig pcfg{.prefer_opencl = cfg.opencl};
   CtrlConfig ccfg{};
+  RunResults results(cfg);
+  results.unpaced();
 
   Ingestor ing(icfg);
   Aggregator agg(acfg);
   Predictor pred(pcfg);
   Controller ctrl(ccfg);
+  // TWIN_CMDS=<path>: publish every tick's commands to a mapped ring file.
+  auto out = CmdStream::from_env(cfg.junctions);
 
   std::vector<SensorSample> samples;
   std::vector<Features> feats;
   std::vector<Prediction> preds;
   std::vector<PhaseCmd> cmds;
 
-  uint32_t ticks = 20;
-  for (uint32_t t = 0; t < ticks; ++t)
+  for (uint32_t t = 0; t < cfg.ticks; ++t)
   {
+    // TWIN_PERF=1: counters per stage, printed after the tick lines.
+    const uint64_t us0 = now_us();
     auto t0 = now_ms();
-    ing.generate(t, samples);
+    {
+      perf::Region r("ingest");
+      ing.generate(t, samples);
+    }
     auto t1 = now_ms();
-    agg.map_features(samples, feats);
+    {
+      perf::Region r("agg");
+      agg.map_features(samples, feats);
+    }
     auto t2 = now_ms();
-    pred.predict_batch(feats, preds);
+    {
+      perf::Region r("pred");
+      pred.predict_batch(feats, preds);
+    }
     auto t3 = now_ms();
-    ctrl.decide(preds, cmds, /*complete*/ true);
+    {
+      perf::Region r("ctrl");
+      ctrl.decide(preds, cmds, /*complete*/ true);
+    }
     auto t4 = now_ms();
     long long lat = (long long)(t4 - t0);
+    if (out)
+      out->publish(t, t, cmds);
 
     // sum-of-stages and explicit latency for Fig 9
     std::printf(
@@ -47,6 +88,9 @@ int main()
         (long long)(t1 - t0), (long long)(t2 - t1),
         (long long)(t3 - t2), (long long)(t4 - t3),
         lat);
+    const double lat_ms = (now_us() - us0) / 1000.0;
+    results.tick(lat_ms, preds.size(), lat_ms > cfg.tick_ms);
   }
-  return 0;
+  perf::report();
+  return results.write() ? 0 : 1;
 }
\ No newline at end of file
@@ -1,76 +1,226 @@
 // smp/main.cpp
 
 #include <thread>
+#include <algorithm>
 #include <atomic>
 #include <vector>
 #include <cstdio>
 #include <chrono>
+#include <cstdlib>
+#include <string>
+#include "common/config.h"
+#include "common/numa.h"
+#include "common/perf.h"
+#include "common/results.h"
 #include "common/ring.h"
 #include "common/timers.h"
 #include "ingest/ingest.h"
 #include "aggregate/aggregate.h"
 #include "predict/predict.h"
 #include "control/control.h"
+#include "control/cmd_stream.h"
 
-int main()
+// Stage placement for TWIN_PIN=1. SMP_DOMAINS="i,a,p,c" picks a NUMA domain
+// per stage (default: everything on domain 0 except the predictor on the last
+// one). The compute stages (A, P) split their domain's cpus and pin one
+// OpenMP worker per cpu; the light stages (I, C) float within their domain.
+struct StagePlacement
 {
-  IngestConfig icfg{.junctions = 2000, .lanes_per = 3, .tick_ms = 1000};
-  AggConfig acfg{.junctions = icfg.junctions, .lanes_per = icfg.lanes_per};
-  PredConfig pcfg{.prefer_opencl = false};
+  std::vector<int> cpus[4]; // I, A, P, C
+  int domain[4]{};
+};
+
+static StagePlacement plan_stages()
+{
+  const auto &topo = numa::topology();
+  const int D = topo.num_domains();
+  StagePlacement sp;
+  sp.domain[2] = D - 1;
+  if (const char *e = std::getenv("SMP_DOMAINS"))
+  {
+    const auto ids = numa::parse_cpulist(e);
+    for (size_t i = 0; i < ids.size() && i < 4; ++i)
+      sp.domain[i] = ids[i] % D;
+  }
+  for (int s = 0; s < 4; ++s)
+    sp.cpus[s] = topo.cpus_of(sp.domain[s]);
+
+  // A and P sharing a domain split it evenly (A first half, P second half).
+  if (sp.domain[1] == sp.domain[2] && sp.cpus[1].size() > 1)
+  {
+    const auto &all = topo.cpus_of(sp.domain[1]);
+    const size_t half = all.size() / 2;
+    sp.cpus[1].assign(all.begin(), all.begin() + half);
+    sp.cpus[2].assign(all.begin() + half, all.end());
+  }
+  return sp;
+}
+
+// One block of a tick on its way through the rings: junctions [j0, j1)
+// (their lanes, for samples). `last` closes the tick; born_ms is when ingest
+// started the tick, for end-to-end latency.
+template <typename T>
+struct Block
+{
+  uint32_t tick = 0, j0 = 0, j1 = 0;
+  bool last = false;
+  uint64_t born_ms = 0;
+  std::vector<T> rows;
+};
+
+int main(int argc, char **argv)
+{
+  // Scenario from --options / environment (common/config.h); the defaults
+  // are the original fixed run: 2000 junctions, 20 ticks, 1024-block rings.
+  TwinConfig cfg;
+  cfg.variant = "smp";
+  cfg.junctions = 2000;
+  if (std::string err; !cfg.parse(argc, argv, err))
+  {
+    if (!err.empty())
+      std::fprintf(stderr, "smp_twin: %s\n", err.c_str());
+    TwinConfig::usage(stderr, argv[0]);
+    return err.empty() ? 0 : 2;
+  }
+  cfg.print(stderr);
+
+  // --lanes=<lo>-<hi> / --lanes-file=<path>: per-junction lane counts (default 3).
+  auto lanes = cfg.lane_index();
+  IngestConfig icfg{.junctions = cfg.junctions, .lanes_per = 3, .tick_ms = cfg.tick_ms, .lanes = lanes};
+  // GRAPH_FILE=<path>: "src dst [weight]" edges for the upstream features.
+  AggConfig acfg{.junctions = icfg.junctions, .lanes_per = icfg.lanes_per, .lanes = lanes,
+                 .window = {cfg.win_short, cfg.win_long}, .graph = JunctionGraph::from_env(icfg.junctions)};
+  PredConfig pcfg{.prefer_opencl = cfg.opencl};
   CtrlConfig ccfg{};
+  RunResults results(cfg);
+
+  const bool pin = std::getenv("TWIN_PIN") && std::atoi(std::getenv("TWIN_PIN")) != 0;
+  const StagePlacement sp = pin ? plan_stages() : StagePlacement{};
+  if (pin)
+  {
+    static const char *kStage[4] = {"I", "A", "P", "C"};
+    for (int s = 0; s < 4; ++s)
+      std::fprintf(stderr, "[PLACE] stage=%s domain=%d cpus=%s%s\n", kStage[s], sp.domain[s],
+                   numa::format_cpulist(sp.cpus[s]).c_str(), (s == 1 || s == 2) ? " (omp pinned)" : "");
+    std::fflush(stderr);
+  }
 
   Ingestor ing(icfg);
-  Aggregator agg(acfg);
   Predictor pred(pcfg);
   Controller ctrl(ccfg);
+  // TWIN_CMDS=<path>: publish every tick's commands to a mapped ring file.
+  auto out = CmdStream::from_env(cfg.junctions);
+
+  // TWIN_CHUNK=<junctions>: stream each tick through the rings in blocks of
+  // that many junctions so every stage starts on a tick before the previous
+  // one has finished it; unset (or >= junctions) moves whole ticks.
+  const uint32_t J = icfg.junctions;
+  uint32_t chunk = J;
+  if (const char *e = std::getenv("TWIN_CHUNK"); e && std::atoi(e) > 0)
+    chunk = std::min<uint32_t>(J, (uint32_t)std::atoi(e));
+  if (chunk < J)
+    std::fprintf(stderr, "[BOOT] chunk=%u junctions (%u blocks/tick)\n", chunk, (J + chunk - 1) / chunk);
 
-  SpscRing<std::vector<SensorSample>> ringIA(1024);
-  SpscRing<std::vector<Features>> ringAP(1024);
-  SpscRing<std::vector<Prediction>> ringPC(1024);
+  SpscRing<Block<SensorSample>> ringIA(cfg.ring);
+  SpscRing<Block<Features>> ringAP(cfg.ring);
+  SpscRing<Block<Prediction>> ringPC(cfg.ring);
+  // Feature buffers go back from P to A once predicted, so each one is
+  // allocated and page-placed once instead of every tick.
+  SpscRing<std::vector<Features>> ringPA(cfg.ring);
 
   std::atomic<bool> stop{false};
   std::atomic<uint32_t> tick{0};
 
   std::thread thI([&]
                   {
+    if (pin) numa::pin_self(sp.cpus[0]);
+    const LaneIndex &lx = ing.lanes();
     while (!stop.load()) {
-      std::vector<SensorSample> s; ing.generate(tick.load(), s);
-      while (!ringIA.push(s)) std::this_thread::sleep_for(std::chrono::microseconds(50));
+      const uint32_t t = tick.load();
+      const uint64_t born = now_ms();
+      for (uint32_t j0 = 0; j0 < J; j0 += chunk) {
+        const uint32_t j1 = std::min(J, j0 + chunk);
+        Block<SensorSample> b{t, j0, j1, j1 == J, born, {}};
+        b.rows.resize(lx.begin(j1) - lx.begin(j0));
+        {
+          perf::Region r("ingest");
+          ing.generate(t, j0, j1, b.rows.data());
+        }
+        while (!ringIA.push(std::move(b))) std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
       std::this_thread::sleep_for(std::chrono::milliseconds(icfg.tick_ms));
       tick.fetch_add(1);
     } });
 
   std::thread thA([&]
                   {
+    // Built on this thread, after pinning, so the per-junction state is
+    // first-touched by the same team that runs map_features.
+    cfg.apply_threads();
+    if (pin) numa::pin_omp_team(sp.cpus[1]);
+    Aggregator agg(acfg);
     while (!stop.load()) {
       auto s = ringIA.pop();
       if (!s) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue; }
-      std::vector<Features> f; agg.map_features(*s, f);
-      while (!ringAP.push(f)) std::this_thread::sleep_for(std::chrono::microseconds(50));
+      Block<Features> f{s->tick, s->j0, s->j1, s->last, s->born_ms, {}};
+      if (auto r = ringPA.pop()) f.rows = std::move(*r);
+      {
+        perf::Region r("agg");
+        if (s->j0 == 0 && s->last) {
+          agg.map_features(s->rows, f.rows);
+        } else {
+          if (s->j0 == 0) agg.begin_tick();
+          f.rows.resize(s->j1 - s->j0);
+          agg.map_block(s->rows.data(), s->j0, s->j1, f.rows.data());
+          if (s->last) agg.end_tick();
+        }
+      }
+      while (!ringAP.push(std::move(f))) std::this_thread::sleep_for(std::chrono::microseconds(50));
     } });
 
   std::thread thP([&]
                   {
+    cfg.apply_threads();
+    if (pin) numa::pin_omp_team(sp.cpus[2]);
     while (!stop.load()) {
       auto f = ringAP.pop();
       if (!f) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue; }
-      std::vector<Prediction> p; pred.predict_batch(*f, p);
-      while (!ringPC.push(p)) std::this_thread::sleep_for(std::chrono::microseconds(50));
+      Block<Prediction> p{f->tick, f->j0, f->j1, f->last, f->born_ms, {}};
+      {
+        perf::Region r("pred");
+        pred.predict_batch(f->rows, p.rows);
+      }
+      ringPA.push(std::move(f->rows)); // full: let this one go
+      while (!ringPC.push(std::move(p))) std::this_thread::sleep_for(std::chrono::microseconds(50));
     } });
 
   std::thread thC([&]
                   {
+    if (pin) numa::pin_self(sp.cpus[3]);
     uint32_t printed = 0;
-    while (printed < 20) {
+    size_t npreds = 0;
+    long long busy = 0;
+    std::vector<PhaseCmd> cmds;
+    while (printed < cfg.ticks) {
       auto t0 = now_ms();
       auto p = ringPC.pop();
       if (!p) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue; }
-      std::vector<PhaseCmd> cmds; ctrl.decide(*p, cmds, /*complete*/true);
+      // Commands go out block by block; the tick line closes on its last block.
+      if (p->j0 == 0) { cmds.clear(); npreds = 0; busy = 0; }
+      {
+        perf::Region r("ctrl");
+        ctrl.decide_append(p->rows.data(), p->rows.size(), 1, cmds, /*complete*/true);
+      }
+      npreds += p->rows.size();
       auto t1 = now_ms();
+      busy += (long long)(t1 - t0);
+      if (!p->last) continue;
 
-      long long lat = (long long)(t1 - t0);
-      std::printf("tick %u | preds=%zu | IA:%zu AP:%zu PC:%zu | lat=%lldms\n",
-        printed, p->size(), ringIA.size(), ringAP.size(), ringPC.size(), lat);
+      std::printf("tick %u | preds=%zu | IA:%zu AP:%zu PC:%zu | lat=%lldms | e2e=%lldms\n",
+        printed, npreds, ringIA.size(), ringAP.size(), ringPC.size(), busy, (long long)(t1 - p->born_ms));
+      results.tick((double)(t1 - p->born_ms), npreds, t1 - p->born_ms > cfg.tick_ms);
+      if (out)
+        out->publish(printed, p->tick, cmds);
       ++printed;
     }
     stop.store(true); });
@@ -79,5 +229,9 @@ int main()
   thP.join();
   thA.join();
   thI.join();
-  return 0;
+  // TWIN_PERF=1: per-stage / per-thread counters after the tick lines.
+  perf::report();
+  results.set("ring", cfg.ring);
+  results.set("chunk", chunk);
+  return results.write() ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+// tests/graph_load.cpp
+// JunctionGraph::load on edge lists with malformed and comment-only lines.
+//
+//   make test
+#include "aggregate/graph.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char *what)
+  {
+    if (!ok)
+    {
+      std::fprintf(stderr, "[TEST] FAIL %s\n", what);
+      ++failures;
+    }
+  }
+
+  std::shared_ptr<const JunctionGraph> load_text(const char *text, uint32_t junctions)
+  {
+    const std::string path = "/tmp/twin_graph_load_" + std::to_string(::getpid()) + ".txt";
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+      return nullptr;
+    std::fputs(text, f);
+    std::fclose(f);
+    auto g = JunctionGraph::load(path.c_str(), junctions);
+    std::remove(path.c_str());
+    return g;
+  }
+
+  // Weighted pull of junction `to` from a unit pressure on junction `from`.
+  float edge(const JunctionGraph &g, uint32_t from, uint32_t to)
+  {
+    std::vector<Pressure> x(g.rows(), Pressure{0.f, 0.f});
+    x[g.to_row(from)] = Pressure{1.f, 1.f};
+    return g.pull(g.to_row(to), x.data()).queue;
+  }
+} // namespace
+
+int main()
+{
+  // A source id alone on its line, then comments (own line and trailing).
+  auto g = load_text("5\n6 7\n# comment only\n  # indented comment\n1 2 3 # trailing\n8\t9\n", 10);
+  check(g != nullptr, "load");
+  if (g)
+  {
+    check(g->edges() == 3, "three edges: truncated and comment lines skipped");
+    check(edge(*g, 5, 6) == 0.f, "no 5->6 edge from the truncated line");
+    check(edge(*g, 6, 7) == 1.f, "6->7 with the default weight");
+    check(std::fabs(edge(*g, 1, 2) - 3.f) < 1e-6f, "1->2 with weight 3");
+    check(edge(*g, 8, 9) == 1.f, "tab-separated 8->9");
+  }
+
+  // Truncated last line without a newline.
+  g = load_text("0 1\n2", 4);
+  check(g && g->edges() == 1, "truncated last line skipped");
+
+  if (failures)
+    return 1;
+  std::printf("[TEST] graph_load OK\n");
+  return 0;
+}
@@ -0,0 +1,27 @@
+# tools/make_graph.py
+# Synthetic road graph for GRAPH_FILE: a W x H street grid with two-way links
+# between neighbours, junction ids shuffled (real ids carry no locality, which
+# is what the RCM renumbering is for).
+import random, sys
+
+if len(sys.argv) < 3:
+    print("usage: python3 tools/make_graph.py <junctions> <output_edges> [seed]")
+    sys.exit(1)
+
+n = int(sys.argv[1])
+outp = sys.argv[2]
+rng = random.Random(int(sys.argv[3]) if len(sys.argv) > 3 else 1)
+
+w = max(1, int(n ** 0.5))
+ids = list(range(n))
+rng.shuffle(ids)
+
+with open(outp, "w") as f:
+    f.write("# src dst weight (%d junctions, %d-wide grid)\n" % (n, w))
+    for v in range(n):
+        x, y = v % w, v // w
+        for u in ((v + 1) if x + 1 < w else -1, v + w):
+            if 0 <= u < n:
+                # Share of the upstream flow turning towards the neighbour.
+                f.write("%d %d %.3f\n" % (ids[v], ids[u], rng.uniform(0.2, 1.0)))
+                f.write("%d %d %.3f\n" % (ids[u], ids[v], rng.uniform(0.2, 1.0)))
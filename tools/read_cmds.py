@@ -0,0 +1,84 @@
+# tools/read_cmds.py
+# Example consumer of the PhaseCmd ring file (TWIN_CMDS=<path>, see
+# control/cmd_stream.h). Maps the file read-only, follows new ticks, checks
+# each slot's sequence lock around the read, and keeps the current command
+# of every junction (keyframes reset it, delta ticks patch it).
+#
+#   TWIN_CMDS=/dev/shm/twin.cmds TWIN_CMDS_DELTA=10 bin/seq_twin &
+#   python3 tools/read_cmds.py /dev/shm/twin.cmds --follow
+#
+# Any number of readers can run at once; none of them can slow the writer.
+# A reader that falls more than `slots` ticks behind skips ahead (lapped=).
+import argparse, mmap, os, struct, sys, time
+
+FILE_HDR = struct.Struct("<QIIIIQQ")  # magic version slots max_cmds junctions slot_bytes published
+TICK_HDR = struct.Struct("<QIIIIQII")  # seq tick_id ts_ms count flags publish_us decided src_tick
+CMD = struct.Struct("<IIBBBx")        # ts_ms junction phase_id delta_sec reason
+MAGIC, VERSION, FULL, MIXED, NO_SOURCE, HDR_BYTES = 0x31444D434E495754, 2, 1, 4, 0xFFFFFFFF, 64
+
+p = argparse.ArgumentParser(description="follow a TWIN_CMDS ring file")
+p.add_argument("path")
+p.add_argument("--follow", action="store_true", help="wait for new ticks until the writer goes quiet")
+p.add_argument("--idle", type=float, default=5.0, help="seconds without a new tick before --follow stops")
+p.add_argument("--dump", type=int, default=0, help="print the first N commands of every tick")
+a = p.parse_args()
+
+with open(a.path, "rb") as f:
+    m = mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ)
+magic, version, slots, max_cmds, junctions, slot_bytes, _ = FILE_HDR.unpack_from(m, 0)
+if magic != MAGIC:
+    sys.exit("%s: not a command ring (magic %#x)" % (a.path, magic))
+if version != VERSION:
+    sys.exit("%s: ring version %d, this reader reads %d" % (a.path, version, VERSION))
+print("[READ] %s v%d slots=%d junctions=%d" % (a.path, version, slots, junctions))
+
+published = lambda: struct.unpack_from("<Q", m, 32)[0]
+state = {}  # junction -> (phase, delta_sec, reason)
+synced, lapped, torn = False, 0, 0
+n = max(0, published() - slots)
+quiet = time.monotonic()
+while True:
+    pub = published()
+    if n >= pub:
+        if not a.follow or time.monotonic() - quiet > a.idle:
+            break
+        time.sleep(0.001)
+        continue
+    if pub - n > slots:
+        lapped += pub - slots - n
+        n = pub - slots
+    off = HDR_BYTES + (n % slots) * slot_bytes
+    seq, tick, ts_ms, count, flags, pub_us, decided, src = TICK_HDR.unpack_from(m, off)
+    if seq != 2 * n + 2:
+        # Being rewritten: for tick n + slots if we were lapped, otherwise
+        # tick n itself is not sealed yet.
+        if seq > 2 * n + 2:
+            lapped += 1
+            n += 1
+        else:
+            time.sleep(0.001)  # not sealed yet: wait for the writer, don't spin
+        continue
+    cmds = [CMD.unpack_from(m, off + HDR_BYTES + i * CMD.size) for i in range(min(count, max_cmds))]
+    if struct.unpack_from("<Q", m, off)[0] != seq:
+        torn += 1  # overwritten while we read it: drop and move on
+        n += 1
+        continue
+
+    full = flags & FULL
+    if full:
+        state = {}
+        synced = True
+    for _, j, ph, d, r in cmds:
+        state[j] = (ph, d, r)
+    # CLOCK_MONOTONIC is the writer's steady clock on Linux.
+    age_ms = (time.monotonic_ns() // 1000 - pub_us) / 1000.0
+    # tick = controller tick; src = the tick the commands were decided from.
+    print("[READ] tick %3d | src=%s%s | %s | cmds=%d of %d | known=%d%s | age=%.1fms" %
+          (tick, "-" if src == NO_SOURCE else src, "+older" if flags & MIXED else "", "full " if full else "delta",
+           count, decided, len(state), "" if synced else " (unsynced)", age_ms))
+    for _, j, ph, d, r in cmds[:a.dump]:
+        print("  junction=%d phase=%d delta=%ds reason=%s" % (j, ph, d, "HEUR" if r else "MODEL"))
+    n += 1
+    quiet = time.monotonic()
+
+print("[READ] done at publication %d lapped=%d torn=%d" % (n, lapped, torn))
@@ -0,0 +1,80 @@
+# tools/sweep.py
+# Scaling sweep over junctions x threads x ranks for the seq/smp/dist builds.
+# Every run writes its --results JSON (common/results.h); the rows are
+# collected into one CSV for capacity planning / tools/make_figs.py.
+#
+#   python3 tools/sweep.py --junctions 5000,20000,80000 --threads 1,2,4 \
+#       --ranks 4,5,6 --ticks 20 --tick-ms 250 --out results/sweep.csv
+#
+# --scaling weak multiplies the junction count by the worker count (OpenMP
+# threads for smp, predictor ranks x threads for dist) so each worker keeps
+# the same load; strong (default) keeps it fixed.
+import argparse, csv, itertools, json, os, shlex, subprocess, sys, tempfile
+
+p = argparse.ArgumentParser(description="seq/smp/dist scaling sweep -> one CSV")
+p.add_argument("--variants", default="seq,smp,dist")
+p.add_argument("--junctions", default="20000", help="comma list")
+p.add_argument("--threads", default="1", help="comma list (OpenMP team per stage / rank)")
+p.add_argument("--ranks", default="4", help="comma list of MPI world sizes for dist (>= 4)")
+p.add_argument("--ticks", type=int, default=20)
+p.add_argument("--tick-ms", type=int, default=1000)
+p.add_argument("--model", default="cpu", choices=["cpu", "opencl"])
+p.add_argument("--scaling", default="strong", choices=["strong", "weak"])
+p.add_argument("--repeat", type=int, default=1)
+p.add_argument("--bin", default="bin")
+p.add_argument("--mpirun", default="mpirun --oversubscribe", help="launcher prefix for dist")
+p.add_argument("--extra", default="", help="more driver options, e.g. '--lanes=2-12'")
+p.add_argument("--out", default="results/sweep.csv")
+a = p.parse_args()
+
+ints = lambda s: [int(x) for x in s.split(",") if x]
+variants = [v for v in a.variants.split(",") if v]
+Js, Ts, Rs = ints(a.junctions), ints(a.threads), ints(a.ranks)
+
+
+def runs():
+    for v in variants:
+        # seq is single-threaded and single-process: one run per J.
+        threads = [1] if v == "seq" else Ts
+        ranks = Rs if v == "dist" else [1]
+        for J, T, R in itertools.product(Js, threads, ranks):
+            workers = T * (max(1, R - 3) if v == "dist" else 1)
+            yield v, (J * workers if a.scaling == "weak" else J), T, R
+
+
+rows, failed = [], 0
+with tempfile.TemporaryDirectory() as tmp:
+    for i, (v, J, T, R) in enumerate(runs()):
+        for rep in range(a.repeat):
+            res = os.path.join(tmp, "run%d_%d.json" % (i, rep))
+            cmd = [os.path.join(a.bin, v + "_twin"), "--junctions=%d" % J, "--threads=%d" % T,
+                   "--ticks=%d" % a.ticks, "--tick-ms=%d" % a.tick_ms, "--model=" + a.model,
+                   "--results=" + res] + shlex.split(a.extra)
+            if v == "dist":
+                cmd = shlex.split(a.mpirun) + ["-np", str(R)] + cmd
+            print("[SWEEP]", " ".join(cmd), file=sys.stderr, flush=True)
+            r = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            if r.returncode != 0 or not os.path.exists(res):
+                print("[SWEEP] failed (rc=%d)" % r.returncode, file=sys.stderr)
+                failed += 1
+                continue
+            with open(res) as f:
+                row = json.load(f)
+            row.update(scaling=a.scaling, repeat=rep)
+            row.setdefault("ranks", 1)
+            rows.append(row)
+
+if not rows:
+    sys.exit("no runs completed")
+
+# Stable columns: the common fields in file order, then anything a driver added.
+cols = []
+for row in rows:
+    cols += [k for k in row if k not in cols]
+os.makedirs(os.path.dirname(a.out) or ".", exist_ok=True)
+with open(a.out, "w", newline="") as f:
+    w = csv.DictWriter(f, fieldnames=cols, restval="")
+    w.writeheader()
+    w.writerows(rows)
+print("[SWEEP] %d runs -> %s (%d failed)" % (len(rows), a.out, failed), file=sys.stderr)
+sys.exit(1 if failed else 0)